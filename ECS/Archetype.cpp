@@ -7,7 +7,7 @@ using namespace ECSTest;
 
 ui64 Archetype::Hash() const
 {
-    return _u.typePart;
+    return _typePart;
 }
 
 Archetype ECSTest::Archetype::FromFull(const ArchetypeFull &source)
@@ -17,7 +17,7 @@ Archetype ECSTest::Archetype::FromFull(const ArchetypeFull &source)
 
 bool ECSTest::Archetype::operator == (const Archetype &other) const
 {
-    bool equalTest = _u.typePart == other._u.typePart;
+    bool equalTest = _typePart == other._typePart;
 #ifdef CHECK_TYPES_IN_ARCHETYPES
     if (equalTest)
     {
@@ -34,20 +34,20 @@ bool ECSTest::Archetype::operator != (const Archetype &other) const
 
 bool ECSTest::Archetype::operator < (const Archetype &other) const
 {
-    return _u.typePart < other._u.typePart;
+    return _typePart < other._typePart;
 }
 
 // Archetype
 
 ui64 ArchetypeFull::Hash() const
 {
-    return (static_cast<ui64>(_u.idPart) << 32) | _u.typePart;
+    return _idPart; // already includes the type part
 }
 
 Archetype ArchetypeFull::ToShort() const
 {
     Archetype result;
-    result._u.typePart = _u.typePart;
+    result._typePart = _typePart;
 #ifdef CHECK_TYPES_IN_ARCHETYPES
     result._storedTypes = _storedTypes;
 #endif
@@ -56,7 +56,7 @@ Archetype ArchetypeFull::ToShort() const
 
 bool ArchetypeFull::operator == (const ArchetypeFull &other) const
 {
-    bool equalTest = _u.typePart == other._u.typePart && _u.idPart == other._u.idPart;
+    bool equalTest = _typePart == other._typePart && _idPart == other._idPart;
 #ifdef CHECK_TYPES_IN_ARCHETYPES
     if (equalTest)
     {
@@ -74,5 +74,5 @@ bool ArchetypeFull::operator != (const ArchetypeFull &other) const
 
 bool ArchetypeFull::operator < (const ArchetypeFull &other) const
 {
-    return std::tie(_u.typePart, _u.idPart) < std::tie(other._u.typePart, other._u.idPart);
+    return std::tie(_typePart, _idPart) < std::tie(other._typePart, other._idPart);
 }
\ No newline at end of file
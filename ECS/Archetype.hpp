@@ -14,15 +14,9 @@ namespace ECSTest
     class Archetype
     {
         friend ArchetypeFull;
+        friend UnitTests;
 
-        union
-        {
-            struct
-            {
-                ui64 idPart : 32;
-                ui64 typePart : 32;
-            } _u{};
-        };
+        ui64 _typePart{}; // hash of the sorted unique types
 
     #ifdef CHECK_TYPES_IN_ARCHETYPES
         friend class ArchetypeReflector;
@@ -63,21 +57,29 @@ namespace ECSTest
                 if (isAdd)
                 {
                     unduplicated[count++] = tType;
-                    result._u.typePart ^= static_cast<ui32>(tType.Hash());
-
-                #ifdef CHECK_TYPES_IN_ARCHETYPES
-                    result._storedTypes.push_back(tType);
-                #endif
                 }
             }
 
+            // the hash depends on the order of the types, so it must be computed over the sorted list
+            std::sort(unduplicated, unduplicated + count);
+            for (uiw index = 0; index < count; ++index)
+            {
+                result._typePart = CombineHash(result._typePart, unduplicated[index].Hash());
+            }
+
         #ifdef CHECK_TYPES_IN_ARCHETYPES
-            std::sort(result._storedTypes.begin(), result._storedTypes.end());
+            result._storedTypes.assign(unduplicated, unduplicated + count);
         #endif
 
             return result;
         }
 
+        // unlike xor folding, the combination is order-dependent, so the same type can't cancel itself out
+        [[nodiscard]] static constexpr ui64 CombineHash(ui64 hash, ui64 value)
+        {
+            return Hash::Integer<Hash::Precision::P64>(hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2)));
+        }
+
         Archetype() = default;
         [[nodiscard]] ui64 Hash() const;
         [[nodiscard]] static Archetype FromFull(const ArchetypeFull &source);
@@ -89,15 +91,10 @@ namespace ECSTest
     class ArchetypeFull
     {
         friend Archetype;
+        friend UnitTests;
 
-        union
-        {
-            struct
-            {
-                ui64 idPart : 32;
-                ui64 typePart : 32;
-            } _u{};
-        };
+        ui64 _typePart{}; // same as Archetype's
+        ui64 _idPart{}; // hash of the sorted type and ComponentID pairs
 
     #ifdef CHECK_TYPES_IN_ARCHETYPES
         friend class ArchetypeReflector;
@@ -111,7 +108,7 @@ namespace ECSTest
             ArchetypeFull result;
             
             auto shor = Archetype::Create<T, E, type>(types);
-            result._u.typePart = shor._u.typePart;
+            result._typePart = shor._typePart;
 
         #ifdef CHECK_TYPES_IN_ARCHETYPES
             result._storedTypes = move(shor._storedTypes);
@@ -122,9 +119,19 @@ namespace ECSTest
             std::sort(result._storedTypesFull.begin(), result._storedTypesFull.end());
         #endif
             
-            for (const T &t : types)
+            using TypeAndID = pair<ui64, ui32>;
+            auto pairs = ALLOCA_TYPED(types.size(), TypeAndID);
+            for (uiw index = 0; index < types.size(); ++index)
+            {
+                pairs[index] = {(types[index].*type).Hash(), (types[index].*id).ID()};
+            }
+            std::sort(pairs, pairs + types.size());
+
+            result._idPart = result._typePart;
+            for (uiw index = 0; index < types.size(); ++index)
             {
-                result._u.idPart ^= Hash::Integer<Hash::Precision::P64>((t.*id).ID());
+                result._idPart = Archetype::CombineHash(result._idPart, pairs[index].first);
+                result._idPart = Archetype::CombineHash(result._idPart, pairs[index].second);
             }
 
             return result;
@@ -3,15 +3,15 @@
 
 using namespace ECSTest;
 
-bool ArchetypeReflector::Contains(const Archetype &archetype) const
+auto ArchetypeReflector::Find(const Archetype &archetype, Array<const TypeId> types) const -> const StoredArchetype *
 {
 	auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Read);
-	bool contains = _library.find(archetype) != _library.end();
+	auto *stored = FindLocked(archetype, types);
     unlocker.Unlock();
-	return contains;
+	return stored;
 }
 
-void ArchetypeReflector::AddToLibrary(const Archetype &archetype, vector<TypeId> &&types)
+auto ArchetypeReflector::AddToLibrary(const Archetype &archetype, vector<TypeId> &&types) -> const StoredArchetype &
 {
 #ifdef CHECK_TYPES_IN_ARCHETYPES
     ASSUME(std::equal(archetype._storedTypes.begin(), archetype._storedTypes.end(), types.begin(), types.end()));
@@ -19,30 +19,40 @@ void ArchetypeReflector::AddToLibrary(const Archetype &archetype, vector<TypeId>
 
 	auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Exclusive);
 
-    // try to add to the archetype library, there's a chance such archetype is already registered
-    auto [it, result] = _library.insert({archetype, move(types)});
-    if (result) // added a new key
+    // there's a chance such archetype is already registered
+    const StoredArchetype *stored = FindLocked(archetype, ToArray(types));
+    if (stored == nullptr)
     {
+		auto it = _library.emplace(archetype.Hash(), StoredArchetype{archetype, move(types)});
+		auto &mask = it->second.mask;
+		for (TypeId type : it->second.types)
+		{
+			AssignComponentIndex(type);
+			mask.Set(_componentIndexes.find(type)->second);
+		}
+		stored = &it->second;
+		_libraryMasks.emplace_back(mask, stored);
+
         // check for matching archetypes
         for (auto &[key, value] : _matchingRequirementArchetypes)
         {
-            if (Satisfies(ToArray(it->second), ToArray(key)))
+            if (value.masks.IsSatisfiedBy(mask))
             {
-                ASSUME(std::find(value.begin(), value.end(), archetype) == value.end());
-                value.push_back(archetype);
+                value.archetypes.push_back(stored);
             }
         }
     }
 	
     unlocker.Unlock();
+	return *stored;
 }
 
 Array<const TypeId> ArchetypeReflector::Reflect(const Archetype &archetype) const
 {
 	auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Read);
-	auto it = _library.find(archetype);
+	auto it = _library.find(archetype.Hash());
 	ASSUME(it != _library.end());
-	auto types = ToArray(it->second);
+	auto types = ToArray(it->second.types);
     unlocker.Unlock();
 #ifdef CHECK_TYPES_IN_ARCHETYPES
     ASSUME(std::equal(types.begin(), types.end(), archetype._storedTypes.begin(), archetype._storedTypes.end()));
@@ -54,7 +64,7 @@ void ArchetypeReflector::StartTrackingMatchingArchetypes(uiw id, Array<const Arc
 {
     auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Exclusive);
 
-    vector<Archetype> *ref = nullptr;
+    MatchingArchetypes *ref = nullptr;
 
     auto existingSearch = _matchingRequirementArchetypes.find(archetypeDefining);
     if (existingSearch != _matchingRequirementArchetypes.end())
@@ -63,16 +73,23 @@ void ArchetypeReflector::StartTrackingMatchingArchetypes(uiw id, Array<const Arc
     }
     else
     {
+		// the tracked masks are updated by AddToLibrary, so all of their types must have indexes
+		for (const auto &requirement : archetypeDefining)
+		{
+			AssignComponentIndex(requirement.type);
+		}
+
         vector<ArchetypeDefiningRequirement> filteredVector = {archetypeDefining.begin(), archetypeDefining.end()};
-        vector<Archetype> matchingArchetypes;
-        for (const auto &[key, value] : _library)
+        MatchingArchetypes matching;
+		matching.masks = CompileLocked(archetypeDefining);
+        for (const auto &[mask, stored] : _libraryMasks)
         {
-            if (Satisfies(ToArray(value), archetypeDefining))
+            if (matching.masks.IsSatisfiedBy(mask))
             {
-                matchingArchetypes.push_back(key);
+                matching.archetypes.push_back(stored);
             }
         }
-        auto [insertKey, insertResult] = _matchingRequirementArchetypes.insert({move(filteredVector), move(matchingArchetypes)});
+        auto [insertKey, insertResult] = _matchingRequirementArchetypes.insert({move(filteredVector), move(matching)});
         ASSUME(insertResult);
         ref = &insertKey->second;
     }
@@ -117,17 +134,172 @@ void ArchetypeReflector::StopTrackingMatchingArchetypes(uiw id)
     unlocker.Unlock();
 }
 
-const vector<Archetype> &ArchetypeReflector::FindMatchingArchetypes(uiw id) const
+auto ArchetypeReflector::FindMatchingArchetypes(uiw id) const -> const vector<const StoredArchetype *> &
 {
     auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Read);
 
-    const auto &ref = *_matchingIDArchetypes.find(id)->second;
+    const auto &ref = _matchingIDArchetypes.find(id)->second->archetypes;
 
     unlocker.Unlock();
 
     return ref;
 }
 
+void ArchetypeReflector::FindMatchingArchetypes(Array<const ArchetypeDefiningRequirement> request, vector<const StoredArchetype *> &output) const
+{
+	auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Read);
+
+	auto masks = CompileLocked(request);
+	if (!masks.isUnsatisfiable)
+	{
+		for (const auto &[mask, stored] : _libraryMasks)
+		{
+			if (masks.IsSatisfiedBy(mask))
+			{
+				output.push_back(stored);
+			}
+		}
+	}
+
+	unlocker.Unlock();
+}
+
+auto ArchetypeReflector::Compile(Array<const ArchetypeDefiningRequirement> request) const -> RequirementMasks
+{
+	auto unlocker = _lock.Lock(DIWRSpinLock::LockType::Read);
+	auto masks = CompileLocked(request);
+	unlocker.Unlock();
+	return masks;
+}
+
+bool ArchetypeReflector::Satisfies(const StoredArchetype &archetype, const RequirementMasks &masks)
+{
+	return masks.IsSatisfiedBy(archetype.mask); // the stored entries don't change, so the lock isn't needed
+}
+
+void ArchetypeReflector::AssignComponentIndex(TypeId type)
+{
+	auto [it, isInserted] = _componentIndexes.try_emplace(type, static_cast<ui32>(_componentIndexes.size()));
+	ASSUME(it->second < maxComponentTypes); // increase maxComponentTypes
+}
+
+auto ArchetypeReflector::FindLocked(const Archetype &archetype, Array<const TypeId> types) const -> const StoredArchetype *
+{
+	auto [begin, end] = _library.equal_range(archetype.Hash());
+	for (auto it = begin; it != end; ++it)
+	{
+		if (std::equal(it->second.types.begin(), it->second.types.end(), types.begin(), types.end()))
+		{
+			return &it->second;
+		}
+	}
+	return nullptr;
+}
+
+auto ArchetypeReflector::CompileLocked(Array<const ArchetypeDefiningRequirement> request) const -> RequirementMasks
+{
+	RequirementMasks masks;
+
+	// see Satisfies, a group is satisfied by any of its required components or by the absence of its subtractive ones,
+	// a present subtractive component fails the whole request
+	for (uiw index = 0; index < request.size(); )
+	{
+		uiw groupEnd = index;
+		bool isSubtractiveGroup = false;
+		while (groupEnd < request.size() && request[groupEnd].group == request[index].group)
+		{
+			isSubtractiveGroup |= request[groupEnd].requirement == RequirementForComponent::Subtractive;
+			++groupEnd;
+		}
+
+		ComponentsMask groupMask;
+		bool isAnyKnown = false;
+		for (uiw groupIndex = index; groupIndex < groupEnd; ++groupIndex)
+		{
+			const auto &requirement = request[groupIndex];
+			ASSUME(requirement.requirement == RequirementForComponent::Required || requirement.requirement == RequirementForComponent::RequiredWithData || requirement.requirement == RequirementForComponent::Subtractive);
+
+			auto it = _componentIndexes.find(requirement.type);
+			if (it == _componentIndexes.end())
+			{
+				continue; // no archetype contains it
+			}
+
+			if (requirement.requirement == RequirementForComponent::Subtractive)
+			{
+				masks.noneOf.Set(it->second);
+			}
+			else
+			{
+				groupMask.Set(it->second);
+				isAnyKnown = true;
+			}
+		}
+
+		if (!isSubtractiveGroup)
+		{
+			if (!isAnyKnown)
+			{
+				masks.isUnsatisfiable = true;
+			}
+			else if (groupEnd - index == 1)
+			{
+				masks.allOf.Set(_componentIndexes.find(request[index].type)->second);
+			}
+			else
+			{
+				masks.anyOf.push_back(groupMask);
+			}
+		}
+
+		index = groupEnd;
+	}
+
+	return masks;
+}
+
+void ArchetypeReflector::ComponentsMask::Set(ui32 index)
+{
+	ASSUME(index < maxComponentTypes);
+	words[index / 64] |= 1ULL << (index % 64);
+}
+
+bool ArchetypeReflector::ComponentsMask::ContainsAll(const ComponentsMask &other) const
+{
+	ui64 missing = 0;
+	for (uiw index = 0; index < words.size(); ++index)
+	{
+		missing |= other.words[index] & ~words[index];
+	}
+	return missing == 0;
+}
+
+bool ArchetypeReflector::ComponentsMask::Intersects(const ComponentsMask &other) const
+{
+	ui64 common = 0;
+	for (uiw index = 0; index < words.size(); ++index)
+	{
+		common |= other.words[index] & words[index];
+	}
+	return common != 0;
+}
+
+bool ArchetypeReflector::RequirementMasks::IsSatisfiedBy(const ComponentsMask &mask) const
+{
+	if (isUnsatisfiable || mask.ContainsAll(allOf) == false || mask.Intersects(noneOf))
+	{
+		return false;
+	}
+	for (const auto &group : anyOf)
+	{
+		if (!mask.Intersects(group))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool ArchetypeReflector::Satisfies(Array<const TypeId> value, Array<const ArchetypeDefiningRequirement> request)
 {
 #ifdef DEBUG
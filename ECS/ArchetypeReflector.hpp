@@ -8,6 +8,40 @@ namespace ECSTest
 {
 	class ArchetypeReflector
 	{
+	public:
+		static constexpr uiw maxComponentTypes = 512; // distinct component types the library can store, the masks take one cache line
+
+		// each bit corresponds to a component type, the indexes are assigned by the reflector in order of appearance
+		struct ComponentsMask
+		{
+			array<ui64, maxComponentTypes / 64> words{};
+
+			void Set(ui32 index);
+			[[nodiscard]] bool ContainsAll(const ComponentsMask &other) const;
+			[[nodiscard]] bool Intersects(const ComponentsMask &other) const;
+		};
+
+		// requirements compiled into masks, follows the same rules as Satisfies
+		struct RequirementMasks
+		{
+			ComponentsMask allOf{};
+			ComponentsMask noneOf{};
+			vector<ComponentsMask> anyOf{}; // one mask per group of RequiredComponentAny
+			bool isUnsatisfiable = false; // requires a component that wasn't known at the compilation
+
+			[[nodiscard]] bool IsSatisfiedBy(const ComponentsMask &mask) const;
+		};
+
+		// each distinct list of types is stored once, the entry's address is stable and identifies the archetype
+		// even if its hash collides with another archetype's hash
+		struct StoredArchetype
+		{
+			Archetype archetype{};
+			vector<TypeId> types{}; // sorted
+			ComponentsMask mask{};
+		};
+
+	private:
         struct MatchingRequirementComparator
         {
             using is_transparent = void;
@@ -17,18 +51,33 @@ namespace ECSTest
 			bool operator () (const Array<const ArchetypeDefiningRequirement> &left, const vector<ArchetypeDefiningRequirement> &right) const;
         };
 
+		struct MatchingArchetypes
+		{
+			RequirementMasks masks{};
+			vector<const StoredArchetype *> archetypes{};
+		};
+
 		DIWRSpinLock _lock{};
-		std::unordered_map<Archetype, vector<TypeId>> _library{}; // all currently stored archetypes with component ids that compose them
-        std::unordered_map<uiw, vector<Archetype> *> _matchingIDArchetypes{}; // maps systems to lists of archetypes that satisfy their requirements
-        std::map<vector<ArchetypeDefiningRequirement>, vector<Archetype>, MatchingRequirementComparator> _matchingRequirementArchetypes{}; // mapping each requirement to the list of archetypes all of whom satisfy it
+		std::unordered_multimap<ui64, StoredArchetype> _library{}; // all currently stored archetypes keyed by their hash, the ones with colliding hashes are told apart by their types
+		vector<pair<ComponentsMask, const StoredArchetype *>> _libraryMasks{}; // same archetypes as in _library, stored contiguously for the scans
+		std::unordered_map<TypeId, ui32> _componentIndexes{}; // bit index of each component type within the masks
+        std::unordered_map<uiw, MatchingArchetypes *> _matchingIDArchetypes{}; // maps systems to lists of archetypes that satisfy their requirements
+        std::map<vector<ArchetypeDefiningRequirement>, MatchingArchetypes, MatchingRequirementComparator> _matchingRequirementArchetypes{}; // mapping each requirement to the list of archetypes all of whom satisfy it
+
+		void AssignComponentIndex(TypeId type); // the exclusive lock must be already taken
+		[[nodiscard]] const StoredArchetype *FindLocked(const Archetype &archetype, Array<const TypeId> types) const; // the lock must be already taken
+		[[nodiscard]] RequirementMasks CompileLocked(Array<const ArchetypeDefiningRequirement> request) const; // the lock must be already taken
 
 	public:
-        [[nodiscard]] bool Contains(const Archetype &archetype) const;
-		void AddToLibrary(const Archetype &archetype, vector<TypeId> &&types);
-        [[nodiscard]] Array<const TypeId> Reflect(const Archetype &archetype) const;
+        [[nodiscard]] const StoredArchetype *Find(const Archetype &archetype, Array<const TypeId> types) const; // nullptr if there's no such archetype in the library
+		const StoredArchetype &AddToLibrary(const Archetype &archetype, vector<TypeId> &&types); // returns the stored entry, the same one for the same types
+        [[nodiscard]] Array<const TypeId> Reflect(const Archetype &archetype) const; // the messages identify archetypes by the hash alone, for colliding hashes the first stored archetype is reflected
         void StartTrackingMatchingArchetypes(uiw id, Array<const ArchetypeDefiningRequirement> archetypeDefining);
         void StopTrackingMatchingArchetypes(uiw id);
-        [[nodiscard]] const vector<Archetype> &FindMatchingArchetypes(uiw id) const; // the reference is valid as long as you continue tracking that id
+        [[nodiscard]] const vector<const StoredArchetype *> &FindMatchingArchetypes(uiw id) const; // the reference is valid as long as you continue tracking that id
+        void FindMatchingArchetypes(Array<const ArchetypeDefiningRequirement> request, vector<const StoredArchetype *> &output) const; // appends the matching archetypes, doesn't require the request to be tracked
+        [[nodiscard]] RequirementMasks Compile(Array<const ArchetypeDefiningRequirement> request) const; // component types that aren't in the library yet can't be matched, compile again after new archetypes are added
+        [[nodiscard]] static bool Satisfies(const StoredArchetype &archetype, const RequirementMasks &masks);
         [[nodiscard]] static bool Satisfies(Array<const TypeId> value, Array<const ArchetypeDefiningRequirement> request);
 	};
-}
\ No newline at end of file
+}
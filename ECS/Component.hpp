@@ -119,6 +119,17 @@ namespace ECSTest
 		using ComponentTypes = tuple<Types...>;
 	};
 
+	struct _ChangedComponentBase
+	{};
+
+	// direct systems only, the archetype groups are passed only if any of these components was written since the system's previous execution,
+	// it doesn't request the components, they have to be requested by the other arguments,
+	// the versions are tracked per group column, so a write to a single row passes the whole group, the unchanged rows included
+	template <typename... Types> struct EMPTY_BASES Changed : _ChangedComponentBase
+	{
+		using ComponentTypes = tuple<Types...>;
+	};
+
 	struct _NonUniqueBase
 	{};
 
@@ -1,22 +1,23 @@
 #include "PreHeader.hpp"
 #include "ComponentArrayBuilder.hpp"
+#include "FrameArena.hpp"
 
 using namespace ECSTest;
 
 ComponentArrayBuilder::ComponentArrayBuilder(const ComponentArrayBuilder &source)
 {
+	// the copy always owns its data, even if the source uses an arena
 	_components = source._components;
-	_data.resize(source._data.size());
-	for (uiw index = 0, dataIndex = 0; index < _components.size(); ++index)
+	for (auto &component : _components)
 	{
-		if (_components[index].isTag)
+		if (component.isTag)
 		{
 			continue;
 		}
-		_data[dataIndex].reset(Allocator::MallocAlignedRuntime::Allocate(_components[index].sizeOf, _components[index].alignmentOf));
-		_components[index].data = _data[dataIndex].get();
-		MemOps::Copy(_data[dataIndex].get(), source._data[dataIndex].get(), _components[index].sizeOf);
-		++dataIndex;
+		unique_ptr<byte[], AlignedMallocDeleter> data(Allocator::MallocAlignedRuntime::Allocate(component.sizeOf, component.alignmentOf));
+		MemOps::Copy(data.get(), component.data, component.sizeOf);
+		component.data = data.get();
+		_data.emplace_back(move(data));
 	}
 }
 
@@ -51,6 +52,14 @@ auto ComponentArrayBuilder::AddComponent(const SerializedComponent &sc) -> Compo
 		return *this;
 	}
 
+	if (_arena)
+	{
+		byte *data = _arena->Allocate(sc.sizeOf, sc.alignmentOf);
+		MemOps::Copy(data, sc.data, sc.sizeOf);
+		_components.back().data = data;
+		return *this;
+	}
+
 	unique_ptr<byte[], AlignedMallocDeleter> data(Allocator::MallocAlignedRuntime::Allocate(sc.sizeOf, sc.alignmentOf));
 	MemOps::Copy(data.get(), sc.data, sc.sizeOf);
 
@@ -62,6 +71,11 @@ auto ComponentArrayBuilder::AddComponent(const SerializedComponent &sc) -> Compo
 	return *this;
 }
 
+void ComponentArrayBuilder::SetArena(FrameArena *arena)
+{
+	_arena = arena;
+}
+
 void ComponentArrayBuilder::Clear()
 {
 	_components.clear();
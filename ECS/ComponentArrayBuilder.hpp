@@ -5,6 +5,8 @@
 
 namespace ECSTest
 {
+    class FrameArena;
+
     class ComponentArrayBuilder
     {
         friend class SystemsManagerMT;
@@ -12,7 +14,8 @@ namespace ECSTest
         friend class MessageBuilder;
 
         vector<SerializedComponent> _components{};
-        vector<unique_ptr<byte[], AlignedMallocDeleter>> _data{};
+        vector<unique_ptr<byte[], AlignedMallocDeleter>> _data{}; // stays empty if the data comes from the arena
+        FrameArena *_arena{};
 
     public:
         ComponentArrayBuilder() = default;
@@ -61,6 +64,7 @@ namespace ECSTest
             static_assert(false_v<T>, "Passed value is not a component");
         }
 
+		void SetArena(FrameArena *arena); // the arena must outlive the added components, pass nullptr to use the heap
 		void Clear();
 		Array<const SerializedComponent> GetComponents() const;
     };
@@ -0,0 +1,84 @@
+#include "PreHeader.hpp"
+#include "ControlsRing.hpp"
+
+using namespace ECSTest;
+
+ControlsRing::ControlsRing(ui32 capacity, FullPolicy fullPolicy) : _fullPolicy(fullPolicy)
+{
+    ASSUME(capacity > 0 && capacity <= (1u << 31));
+
+    ui32 rounded = 1;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    _slots = make_unique<Slot[]>(rounded);
+    _mask = rounded - 1;
+    for (ui32 index = 0; index < rounded; ++index)
+    {
+        _slots[index].sequence.store(index, std::memory_order_relaxed);
+    }
+}
+
+bool ControlsRing::Push(const ControlAction &action)
+{
+    ui64 position = _tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = _slots[position & _mask];
+        ui64 sequence = slot.sequence.load(std::memory_order_acquire);
+        i64 difference = static_cast<i64>(sequence - position);
+
+        if (difference == 0)
+        {
+            // the slot is free, claim the position, on failure position receives the current tail
+            if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.action = action;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the slot still holds the action pushed a lap ago, the ring is full
+            if (_fullPolicy == FullPolicy::DropNewest)
+            {
+                _droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();
+            position = _tail.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            position = _tail.load(std::memory_order_relaxed); // another producer took the position
+        }
+    }
+}
+
+bool ControlsRing::TryPop(ControlAction &action)
+{
+    Slot &slot = _slots[_head & _mask];
+    if (slot.sequence.load(std::memory_order_acquire) != _head + 1)
+    {
+        return false;
+    }
+
+    action = move(slot.action);
+    slot.action = {}; // releases the custom action's data
+    slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+    ++_head;
+    return true;
+}
+
+ui32 ControlsRing::Capacity() const
+{
+    return static_cast<ui32>(_mask + 1);
+}
+
+ui64 ControlsRing::DroppedCount() const
+{
+    return _droppedCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "IKeyController.hpp"
+
+namespace ECSTest
+{
+    // bounded lock-free queue of control actions, any number of threads can push into it, a single thread pops,
+    // used to pass the input from the OS input threads to the scheduler, the actions keep their occuredAt
+    class ControlsRing
+    {
+        struct Slot
+        {
+            std::atomic<ui64> sequence{}; // equals the position when the slot is free for the producer, position + 1 when it's filled
+            ControlAction action{};
+        };
+
+    public:
+        enum class FullPolicy
+        {
+            DropNewest, // Push returns false and the action is counted as dropped
+            Wait // Push yields until the consumer frees a slot
+        };
+
+        static constexpr ui32 defaultCapacity = 1024;
+
+        explicit ControlsRing(ui32 capacity = defaultCapacity, FullPolicy fullPolicy = FullPolicy::DropNewest); // the capacity is rounded up to a power of two
+        ControlsRing(ControlsRing &&) = delete;
+        ControlsRing &operator = (ControlsRing &&) = delete;
+
+        bool Push(const ControlAction &action); // can be called from any thread, returns false if the action was dropped
+        [[nodiscard]] bool TryPop(ControlAction &action); // must be called from a single thread at a time
+        [[nodiscard]] ui32 Capacity() const;
+        [[nodiscard]] ui64 DroppedCount() const;
+
+    private:
+        unique_ptr<Slot[]> _slots{};
+        ui64 _mask{};
+        FullPolicy _fullPolicy{};
+        alignas(64) std::atomic<ui64> _tail{}; // next position to push into
+        alignas(64) ui64 _head{}; // next position to pop from, accessed only by the consumer
+        std::atomic<ui64> _droppedCount{};
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "SystemCreation.hpp"
+
+namespace ECSTest
+{
+	// read-only access to the components stored by the manager, lets indirect systems read the current state instead of mirroring it from the messages,
+	// the callable accepts the same arguments as DirectSystem::Accept except Environment, it is called once per matching archetype group,
+	// can only be used from within the indirect system's methods, the arrays are valid until the callable returns
+    class NOVTABLE IDirectQuery
+    {
+    protected:
+        ~IDirectQuery() = default;
+
+    public:
+		using Callback = void (*)(void *context, void **array);
+
+		virtual void ForEachUntyped(const System::Requests &requests, Callback callback, void *context) = 0;
+
+		template <typename T> void ForEach(T &&callable)
+		{
+			using callableType = remove_reference_t<T>;
+			using types = typename FunctionInfo::Info<decltype(&callableType::operator())>::args;
+
+			static constexpr auto requestedComponentsTuple = _SystemAuxFuncs::AcquireRequestedComponents<decltype(&callableType::operator())>();
+			static constexpr System::Requests requests = _SystemAuxFuncs::ComponentsTupleToRequests(requestedComponentsTuple);
+			static_assert(requests.writeAccess.size() == 0, "Direct queries are read-only, pass the component arrays by const reference");
+			static_assert(requests.environmentIndex == nullopt, "Direct queries cannot request Environment");
+			static_assert(requests.changed.size() == 0, "Direct queries cannot use Changed");
+
+			auto callback = [](void *context, void **array)
+			{
+				_SystemAuxFuncs::CallCallable<types>(*static_cast<callableType *>(context), array, make_index_sequence<tuple_size_v<types>>());
+			};
+
+			ForEachUntyped(requests, callback, const_cast<void *>(static_cast<const void *>(&callable)));
+		}
+    };
+}
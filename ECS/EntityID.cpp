@@ -20,6 +20,15 @@ EntityID EntityIDGenerator::Generate()
     return id;
 }
 
+void EntityIDGenerator::Generate(Array<EntityID> target)
+{
+	for (EntityID &id : target)
+	{
+		id = EntityID(_currentId, _hintGenerator.Allocate());
+		_currentId += 1;
+	}
+}
+
 void EntityIDGenerator::Free(EntityID id)
 {
 	_hintGenerator.Free(id.Hint());
@@ -25,6 +25,7 @@ namespace ECSTest
 
     public:
 		[[nodiscard]] EntityID Generate();
+		void Generate(Array<EntityID> target); // fills the whole array, the ids are unique but not necessarily contiguous, the freed hints get reused
 		void Free(EntityID id); // use it when you're removing an entity from ECS manager to release the hint so it can be reused
         EntityIDGenerator() = default;
         EntityIDGenerator(EntityIDGenerator &&source) noexcept;
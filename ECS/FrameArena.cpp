@@ -0,0 +1,56 @@
+#include "PreHeader.hpp"
+#include "FrameArena.hpp"
+
+using namespace ECSTest;
+
+byte *FrameArena::Allocate(uiw size, uiw alignment)
+{
+    ASSUME(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    for (; _currentChunk < _chunks.size(); ++_currentChunk, _offset = 0)
+    {
+        auto &chunk = _chunks[_currentChunk];
+        uiw start = reinterpret_cast<uiw>(chunk.memory.get());
+        uiw aligned = ((start + _offset + alignment - 1) & ~(alignment - 1)) - start;
+        if (aligned + size <= chunk.size)
+        {
+            _offset = aligned + size;
+            return chunk.memory.get() + aligned;
+        }
+    }
+
+    Chunk chunk;
+    chunk.size = std::max(defaultChunkSize, size);
+    chunk.memory.reset(Allocator::MallocAlignedRuntime::Allocate(chunk.size, std::max(chunkAlignment, alignment)));
+    _chunks.push_back(move(chunk));
+
+    _currentChunk = _chunks.size() - 1;
+    _offset = size;
+    return _chunks.back().memory.get();
+}
+
+void FrameArena::Reset()
+{
+    if (_chunks.size() > 1)
+    {
+        // the previous frame didn't fit into a single chunk, replace them with one that fits everything
+        Chunk chunk;
+        chunk.size = Reserved();
+        _chunks.clear();
+        chunk.memory.reset(Allocator::MallocAlignedRuntime::Allocate(chunk.size, chunkAlignment));
+        _chunks.push_back(move(chunk));
+    }
+
+    _currentChunk = 0;
+    _offset = 0;
+}
+
+uiw FrameArena::Reserved() const
+{
+    uiw total = 0;
+    for (const auto &chunk : _chunks)
+    {
+        total += chunk.size;
+    }
+    return total;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace ECSTest
+{
+    // bump allocator for message payloads, all allocations are released at once by Reset
+    class FrameArena
+    {
+        struct Chunk
+        {
+            unique_ptr<byte[], AlignedMallocDeleter> memory{};
+            uiw size{};
+        };
+
+        vector<Chunk> _chunks{};
+        uiw _currentChunk{};
+        uiw _offset{}; // within the current chunk
+
+        static constexpr uiw defaultChunkSize = 64 * 1024;
+        static constexpr uiw chunkAlignment = 64;
+
+    public:
+        FrameArena() = default;
+        FrameArena(FrameArena &&) = default;
+        FrameArena &operator = (FrameArena &&) = default;
+
+        [[nodiscard]] byte *Allocate(uiw size, uiw alignment);
+        void Reset(); // the memory is kept for the next allocations
+        [[nodiscard]] uiw Reserved() const;
+    };
+}
@@ -27,18 +27,35 @@ bool MessageBuilder::IsEmpty() const
         _componentChangedStreams._data.empty() &&
         _componentAddedStreams._data.empty() &&
         _componentRemovedStreams._data.empty() &&
-        _entityRemovedNoArchetype.empty();
+        _entityRemovedNoArchetype.empty() &&
+        _entitiesBatches.empty() &&
+        _matchingCommands.empty();
 }
 
 void MessageBuilder::Clear()
 {
     _cab.Clear();
     _entityAddedStreams._data.clear();
+    _entityAddedStreams._index.Clear();
     _entityRemovedStreams._data.clear();
+    _entityRemovedStreams._index.Clear();
     _componentAddedStreams._data.clear();
+    _componentAddedStreams._index.Clear();
     _componentChangedStreams._data.clear();
+    _componentChangedStreams._index.Clear();
     _componentRemovedStreams._data.clear();
+    _componentRemovedStreams._index.Clear();
     _entityRemovedNoArchetype.clear();
+    _entitiesBatches.clear();
+    _matchingCommands.clear();
+    _currentEntityId = {};
+
+    _entityAddedStreams._pool.Recycle([](auto &stream) { stream.clear(); });
+    _entityRemovedStreams._pool.Recycle([](auto &stream) { stream.clear(); });
+    _componentAddedStreams._pool.Recycle([](auto &stream) { stream.clear(); });
+    _componentChangedStreams._pool.Recycle([](auto &stream) { stream.Reset(); });
+    _componentRemovedStreams._pool.Recycle([](auto &stream) { stream.entityIds.clear(); stream.componentIds.clear(); });
+    _currentArena = {};
 }
 
 void MessageBuilder::Flush()
@@ -54,20 +71,7 @@ void MessageBuilder::Flush()
 	entry.components = move(_cab._components);
 	entry.componentsData = move(_cab._data);
 
-    const auto &target = [this](const Archetype &archetype) -> const shared_ptr<vector<MessageStreamRegisterEntity::EntityWithComponents>> &
-    {
-        for (const auto &[key, value] : _entityAddedStreams._data)
-        {
-            if (key == archetype)
-            {
-                return value;
-            }
-        }
-        _entityAddedStreams._data.emplace_back(archetype, make_shared<vector<MessageStreamRegisterEntity::EntityWithComponents>>());
-        return _entityAddedStreams._data.back().second;
-    } (archetype);
-
-    target->push_back(move(entry));
+    FindOrAddEntityAddedStream(archetype).push_back(move(entry));
 
 	_currentEntityId = {};
 }
@@ -78,6 +82,7 @@ ComponentArrayBuilder &MessageBuilder::AddEntity(EntityID id)
 	Flush();
 	_currentEntityId = id;
 	_cab.Clear();
+	_cab.SetArena(CurrentArena().get());
 	return _cab;
 }
 
@@ -112,6 +117,65 @@ const vector<EntityID> &MessageBuilder::EntityRemovedNoArchetype()
     return _entityRemovedNoArchetype;
 }
 
+auto MessageBuilder::CurrentArena() -> const shared_ptr<FrameArena> &
+{
+	if (_currentArena)
+	{
+		return _currentArena;
+	}
+
+	for (const auto &arena : _arenas)
+	{
+		if (arena.use_count() == 1) // not referenced by any stream
+		{
+			arena->Reset();
+			_currentArena = arena;
+			return _currentArena;
+		}
+	}
+
+	_currentArena = _arenas.emplace_back(make_shared<FrameArena>());
+	return _currentArena;
+}
+
+auto MessageBuilder::FindOrAddEntityAddedStream(const Archetype &archetype) -> vector<MessageStreamRegisterEntity::EntityWithComponents> &
+{
+	ui32 index = _entityAddedStreams._index.Find(_entityAddedStreams._data, archetype);
+	if (index != ui32_max)
+	{
+		return *_entityAddedStreams._data[index].second;
+	}
+	_entityAddedStreams._index.Add(archetype.Hash(), static_cast<ui32>(_entityAddedStreams._data.size()));
+	_entityAddedStreams._data.emplace_back(archetype, _entityAddedStreams._pool.Acquire(CurrentArena()));
+	return *_entityAddedStreams._data.back().second;
+}
+
+auto MessageBuilder::FindOrAddComponentChangedStream(const ComponentDescription &desc) -> MessageStreamComponentChanged::InfoWithData &
+{
+	ui32 index = _componentChangedStreams._index.Find(_componentChangedStreams._data, desc.type);
+	if (index != ui32_max)
+	{
+		auto &entry = *_componentChangedStreams._data[index].second.second;
+		ASSUME(entry.IsView() == false);
+		return entry;
+	}
+	_componentChangedStreams._index.Add(desc.type.Hash(), static_cast<ui32>(_componentChangedStreams._data.size()));
+	_componentChangedStreams._data.emplace_back(desc.type, pair<ComponentDescription, shared_ptr<MessageStreamComponentChanged::InfoWithData>>(desc, _componentChangedStreams._pool.Acquire({})));
+	return *_componentChangedStreams._data.back().second.second;
+}
+
+auto MessageBuilder::ComponentChangedView(const ComponentDescription &desc, Array<const EntityID> entityIds, const byte *data) -> shared_ptr<MessageStreamComponentChanged::InfoWithData>
+{
+	ASSUME(desc.isUnique && desc.isTag == false);
+	ASSUME(entityIds.size() && data);
+
+	auto info = make_shared<MessageStreamComponentChanged::InfoWithData>();
+	info->viewEntityIds = entityIds;
+	info->viewData = data;
+	_componentChangedStreams._data.emplace_back(desc.type, pair<ComponentDescription, shared_ptr<MessageStreamComponentChanged::InfoWithData>>(desc, info));
+	return info;
+}
+
 EntityID ECSTest::MessageBuilder::AddEntity(string_view debugName)
 {
     ASSUME(_entityIdGenerator);
@@ -120,9 +184,178 @@ EntityID ECSTest::MessageBuilder::AddEntity(string_view debugName)
     Flush();
     _currentEntityId = entityId;
     _cab.Clear();
+    _cab.SetArena(CurrentArena().get());
 	return entityId;
 }
 
+Array<const EntityID> MessageBuilder::SpawnBatch(Array<const SerializedComponent> columns, uiw count)
+{
+	ASSUME(count && columns.size());
+
+	#ifdef DEBUG
+		for (const auto &column : columns)
+		{
+			ASSUME(column.isUnique && column.id.IsValid() == false); // non-unique components would need ComponentIDs for every entity
+			ASSUME(column.isTag == (column.data == nullptr));
+		}
+	#endif
+
+	auto archetype = ArchetypeFull::Create<SerializedComponent, ComponentDescription, &SerializedComponent::type, &SerializedComponent::id>(columns);
+	auto &batch = AllocateEntitiesBatch(archetype, columns, count);
+
+	for (uiw index = 0; index < columns.size(); ++index)
+	{
+		if (!columns[index].isTag)
+		{
+			MemOps::Copy(const_cast<byte *>(batch.columns[index].data), columns[index].data, columns[index].sizeOf * count);
+		}
+	}
+
+	return batch.entityIds;
+}
+
+PrefabInstances MessageBuilder::Instantiate(const Prefab &prefab, uiw count, string_view debugName)
+{
+	ASSUME(count && prefab._components.size());
+
+	Array<const EntityID> entityIds;
+	Array<SerializedComponent> columns;
+
+	// the ids are stored in the builder's arena, so they can be named in place before they're copied anywhere
+	auto nameEntities = [&entityIds, debugName]
+	{
+		if (debugName.size())
+		{
+			for (const EntityID &entityID : entityIds)
+			{
+				const_cast<EntityID &>(entityID).DebugName(debugName);
+			}
+		}
+	};
+
+	if (prefab._isUniqueOnly)
+	{
+		auto &batch = AllocateEntitiesBatch(prefab._archetypeFull, ToArray(prefab._components), count);
+		entityIds = batch.entityIds;
+		nameEntities();
+		columns = ToArray(batch.columns);
+	}
+	else
+	{
+		// every instance receives its own ComponentIDs for the non-unique components when it's registered,
+		// so the instances can't share an archetype group, they're added as separate entities referencing the columns instead
+		Flush();
+
+		const auto &arena = CurrentArena();
+		entityIds = GenerateEntityIds(count);
+		nameEntities();
+
+		auto *columnsData = reinterpret_cast<SerializedComponent *>(arena->Allocate(sizeof(SerializedComponent) * prefab._components.size(), alignof(SerializedComponent)));
+		std::uninitialized_copy(prefab._components.begin(), prefab._components.end(), columnsData);
+		columns = Array<SerializedComponent>(columnsData, prefab._components.size());
+		for (auto &column : columns)
+		{
+			if (!column.isTag)
+			{
+				column.data = arena->Allocate(column.sizeOf * count, column.alignmentOf);
+			}
+		}
+
+		auto &stream = FindOrAddEntityAddedStream(prefab._archetype);
+		for (uiw index = 0; index < count; ++index)
+		{
+			auto &entry = stream.emplace_back();
+			entry.entityID = entityIds[index];
+			entry.components.assign(columns.begin(), columns.end());
+			for (auto &component : entry.components)
+			{
+				if (!component.isTag)
+				{
+					component.data += component.sizeOf * index;
+				}
+			}
+		}
+	}
+
+	for (uiw index = 0; index < columns.size(); ++index)
+	{
+		const auto &source = prefab._components[index];
+		if (source.isTag)
+		{
+			continue;
+		}
+
+		// copy the first row, then keep doubling the copied part
+		byte *target = const_cast<byte *>(columns[index].data);
+		MemOps::Copy(target, source.data, source.sizeOf);
+		for (uiw copied = 1; copied < count; )
+		{
+			uiw toCopy = std::min(copied, count - copied);
+			MemOps::Copy(target + copied * source.sizeOf, target, toCopy * source.sizeOf);
+			copied += toCopy;
+		}
+	}
+
+	return {entityIds, columns};
+}
+
+Array<const EntityID> MessageBuilder::GenerateEntityIds(uiw count)
+{
+	ASSUME(_entityIdGenerator);
+
+	auto *ids = reinterpret_cast<EntityID *>(CurrentArena()->Allocate(sizeof(EntityID) * count, alignof(EntityID)));
+	std::uninitialized_default_construct_n(ids, count);
+	_entityIdGenerator->Generate(Array<EntityID>(ids, count));
+	return Array<const EntityID>(ids, count);
+}
+
+auto MessageBuilder::AllocateEntitiesBatch(const ArchetypeFull &archetype, Array<const SerializedComponent> columns, uiw count) -> EntitiesBatch &
+{
+	Flush();
+
+	const auto &arena = CurrentArena();
+
+	EntitiesBatch batch;
+	batch.arena = arena;
+	batch.archetypeFull = archetype;
+	batch.archetype = archetype.ToShort();
+	batch.entityIds = GenerateEntityIds(count);
+
+	batch.columns.assign(columns.begin(), columns.end());
+	for (auto &column : batch.columns)
+	{
+		if (!column.isTag)
+		{
+			column.data = arena->Allocate(column.sizeOf * count, column.alignmentOf);
+		}
+	}
+
+	_entitiesBatches.push_back(move(batch));
+	return _entitiesBatches.back();
+}
+
+auto MessageBuilder::EntitiesBatchToStream(const EntitiesBatch &batch) -> shared_ptr<vector<MessageStreamRegisterEntity::EntityWithComponents>>
+{
+	auto stream = _entityAddedStreams._pool.Acquire(batch.arena);
+	stream->resize(batch.entityIds.size());
+
+	for (uiw index = 0; index < batch.entityIds.size(); ++index)
+	{
+		auto &entry = (*stream)[index];
+		entry.entityID = batch.entityIds[index];
+		entry.components = batch.columns;
+		for (auto &component : entry.components)
+		{
+			if (!component.isTag)
+			{
+				component.data += component.sizeOf * index;
+			}
+		}
+	}
+
+	return stream;
+}
+
 void MessageBuilder::AddComponent(EntityID entityID, const SerializedComponent &sc)
 {
 	ASSUME(entityID);
@@ -141,14 +374,13 @@ void MessageBuilder::AddComponent(EntityID entityID, const SerializedComponent &
 
     const auto &entry = [this](TypeId type) -> const shared_ptr<vector<MessageStreamComponentAdded::EntityWithComponents>> &
     {
-        for (const auto &[key, value] : _componentAddedStreams._data)
+        ui32 index = _componentAddedStreams._index.Find(_componentAddedStreams._data, type);
+        if (index != ui32_max)
         {
-            if (key == type)
-            {
-                return value;
-            }
+            return _componentAddedStreams._data[index].second;
         }
-        _componentAddedStreams._data.emplace_back(type, make_shared<vector<MessageStreamComponentAdded::EntityWithComponents>>());
+        _componentAddedStreams._index.Add(type.Hash(), static_cast<ui32>(_componentAddedStreams._data.size()));
+        _componentAddedStreams._data.emplace_back(type, _componentAddedStreams._pool.Acquire(CurrentArena()));
         return _componentAddedStreams._data.back().second;
     } (sc.type);
 
@@ -156,6 +388,7 @@ void MessageBuilder::AddComponent(EntityID entityID, const SerializedComponent &
     auto &last = entry->back();
     last.entityID = entityID;
     last.addedComponentID = sc.id;
+    last.cab.SetArena(CurrentArena().get());
     last.cab.AddComponent(sc);
 
     ASSUME(last.components.empty() && last.componentsData.empty());
@@ -167,71 +400,36 @@ void MessageBuilder::ComponentChanged(EntityID entityID, const SerializedCompone
 	ASSUME(sc.isUnique != sc.id.IsValid());
     ASSUME(sc.isTag == false);
 
-    const auto &entry = [this](const SerializedComponent &sc) -> const shared_ptr<MessageStreamComponentChanged::InfoWithData> &
-    {
-        for (const auto &[key, value] : _componentChangedStreams._data)
-        {
-            if (key == sc.type)
-            {
-                return value.second;
-            }
-        }
-        _componentChangedStreams._data.emplace_back(sc.type, pair<ComponentDescription, shared_ptr<MessageStreamComponentChanged::InfoWithData>>(sc, make_shared<MessageStreamComponentChanged::InfoWithData>()));
-        return _componentChangedStreams._data.back().second.second;
-    } (sc);
-
-    uiw copyIndex = sc.sizeOf * entry->entityIds.size();
-
-    if (copyIndex + sc.sizeOf > entry->dataReserved)
-    {
-        entry->dataReserved *= 2;
-        entry->dataReserved += sc.sizeOf;
-
-        ASSUME(entry->dataReserved >= copyIndex + sc.sizeOf);
+    FindOrAddComponentChangedStream(sc).Append(entityID, sc.data, sc.id, sc.sizeOf, sc.alignmentOf);
+}
 
-		byte *oldPtr = entry->data.release();
-		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, entry->dataReserved, sc.alignmentOf);
-        entry->data.reset(newPtr);
-    }
+byte *MessageBuilder::ComponentChangedReserve(const ComponentDescription &desc, Array<const EntityID> entityIds, Array<const ComponentID> ids)
+{
+    ASSUME(desc.isTag == false);
+    ASSUME(desc.isUnique == ids.empty());
 
-    entry->entityIds.emplace_back(entityID);
-	if (sc.isUnique == false)
-	{
-		entry->componentIds.emplace_back(sc.id);
-	}
-    MemOps::Copy(entry->data.get() + copyIndex, sc.data, sc.sizeOf);
+    return FindOrAddComponentChangedStream(desc).AppendRange(entityIds, ids, desc.sizeOf, desc.alignmentOf);
 }
 
 void MessageBuilder::ComponentChangedHint(const ComponentDescription &desc, uiw count)
 {
-	const auto &entry = [this](const ComponentDescription &desc) -> const shared_ptr<MessageStreamComponentChanged::InfoWithData> &
-	{
-		for (const auto &[key, value] : _componentChangedStreams._data)
-		{
-			if (key == desc.type)
-			{
-				return value.second;
-			}
-		}
-		_componentChangedStreams._data.emplace_back(desc.type, pair<ComponentDescription, shared_ptr<MessageStreamComponentChanged::InfoWithData>>(desc, make_shared<MessageStreamComponentChanged::InfoWithData>()));
-		return _componentChangedStreams._data.back().second.second;
-	} (desc);
+	auto &entry = FindOrAddComponentChangedStream(desc);
 
-	entry->entityIds.reserve(count);
+	entry.entityIds.reserve(count);
 	if (desc.isUnique == false)
 	{
-		entry->componentIds.reserve(count);
+		entry.componentIds.reserve(count);
 	}
 
 	uiw memSize = count * desc.sizeOf;
 
-	if (memSize > entry->dataReserved)
+	if (memSize > entry.dataReserved)
 	{
-		entry->dataReserved = static_cast<ui32>(memSize);
+		entry.dataReserved = static_cast<ui32>(memSize);
 
-		byte *oldPtr = entry->data.release();
-		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, entry->dataReserved, desc.alignmentOf);
-		entry->data.reset(newPtr);
+		byte *oldPtr = entry.data.release();
+		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, entry.dataReserved, desc.alignmentOf);
+		entry.data.reset(newPtr);
 	}
 }
 
@@ -247,14 +445,13 @@ void MessageBuilder::RemoveComponent(EntityID entityID, TypeId type, ComponentID
 
     const auto &entry = [this](TypeId type) -> const shared_ptr<MessageStreamComponentRemoved::ComponentsInfo> &
     {
-        for (const auto &[key, value] : _componentRemovedStreams._data)
+        ui32 index = _componentRemovedStreams._index.Find(_componentRemovedStreams._data, type);
+        if (index != ui32_max)
         {
-            if (key == type)
-            {
-                return value;
-            }
+            return _componentRemovedStreams._data[index].second;
         }
-        _componentRemovedStreams._data.emplace_back(type, make_shared<MessageStreamComponentRemoved::ComponentsInfo>());
+        _componentRemovedStreams._index.Add(type.Hash(), static_cast<ui32>(_componentRemovedStreams._data.size()));
+        _componentRemovedStreams._data.emplace_back(type, _componentRemovedStreams._pool.Acquire({}));
         return _componentRemovedStreams._data.back().second;
     } (type);
 
@@ -288,16 +485,313 @@ void MessageBuilder::RemoveEntity(EntityID entityID, Archetype archetype)
 
     const auto &entry = [this](const Archetype &archetype) -> const shared_ptr<vector<EntityID>> &
     {
-        for (const auto &[key, value] : _entityRemovedStreams._data)
+        ui32 index = _entityRemovedStreams._index.Find(_entityRemovedStreams._data, archetype);
+        if (index != ui32_max)
         {
-            if (key == archetype)
-            {
-                return value;
-            }
+            return _entityRemovedStreams._data[index].second;
         }
-        _entityRemovedStreams._data.emplace_back(archetype, make_shared<vector<EntityID>>());
+        _entityRemovedStreams._index.Add(archetype.Hash(), static_cast<ui32>(_entityRemovedStreams._data.size()));
+        _entityRemovedStreams._data.emplace_back(archetype, _entityRemovedStreams._pool.Acquire({}));
         return _entityRemovedStreams._data.back().second;
     } (archetype);
 
     entry->push_back(entityID);
-}
\ No newline at end of file
+}
+
+void MessageBuilder::DestroyMatching(Array<const ArchetypeDefiningRequirement> query)
+{
+	ASSUME(query.size());
+	Flush();
+	_matchingCommands.push_back({MatchingCommand::Action::Destroy, {}, {query.begin(), query.end()}});
+}
+
+void MessageBuilder::AddTagMatching(const ComponentDescription &tag, Array<const ArchetypeDefiningRequirement> query)
+{
+	ASSUME(tag.isTag && query.size());
+	Flush();
+	_matchingCommands.push_back({MatchingCommand::Action::AddTag, tag, {query.begin(), query.end()}});
+}
+
+void MessageBuilder::RemoveTagMatching(const ComponentDescription &tag, Array<const ArchetypeDefiningRequirement> query)
+{
+	ASSUME(tag.isTag && query.size());
+	Flush();
+	_matchingCommands.push_back({MatchingCommand::Action::RemoveTag, tag, {query.begin(), query.end()}});
+}
+
+void MessageBuilder::Coalesce()
+{
+    Flush();
+
+    auto componentKey = [](EntityID entityID, ComponentID componentID)
+    {
+        return (static_cast<ui64>(entityID.Hash()) << 32) | componentID.Hash();
+    };
+
+    // After EntityRemoved: EntityRemoved is ignored
+    _coalescingRemoved.clear();
+    for (auto &[archetype, stream] : _entityRemovedStreams._data)
+    {
+        auto newEnd = std::remove_if(stream->begin(), stream->end(), [this](EntityID id) { return _coalescingRemoved.insert(id).second == false; });
+        stream->erase(newEnd, stream->end());
+    }
+
+    auto isRemoved = [this](EntityID id)
+    {
+        return _coalescingRemoved.find(id) != _coalescingRemoved.end();
+    };
+
+    // After EntityRemoved: ComponentAdded is ignored
+    for (auto &[type, stream] : _componentAddedStreams._data)
+    {
+        auto newEnd = std::remove_if(stream->begin(), stream->end(), [&isRemoved](const MessageStreamComponentAdded::EntityWithComponents &entry) { return isRemoved(entry.entityID); });
+        stream->erase(newEnd, stream->end());
+    }
+
+    // After EntityRemoved and ComponentRemoved: ComponentRemoved is ignored
+    for (auto &[type, stream] : _componentRemovedStreams._data)
+    {
+        _coalescingIndexes.clear();
+
+        uiw target = 0;
+        for (uiw index = 0, size = stream->entityIds.size(); index < size; ++index)
+        {
+            EntityID entityID = stream->entityIds[index];
+            ComponentID componentID = stream->componentIds.size() ? stream->componentIds[index] : ComponentID{};
+            if (isRemoved(entityID) || _coalescingIndexes.emplace(componentKey(entityID, componentID), 0).second == false)
+            {
+                continue;
+            }
+            stream->entityIds[target] = entityID;
+            if (stream->componentIds.size())
+            {
+                stream->componentIds[target] = componentID;
+            }
+            ++target;
+        }
+
+        stream->entityIds.resize(target);
+        if (stream->componentIds.size())
+        {
+            stream->componentIds.resize(target);
+        }
+    }
+
+    // After EntityRemoved and ComponentRemoved: ComponentChanged is ignored
+    // After ComponentChanged: ComponentChanged is applied, so only the last change is kept
+    for (auto &[type, descWithStream] : _componentChangedStreams._data)
+    {
+        auto &[desc, stream] = descWithStream;
+
+        if (stream->IsView())
+        {
+            continue; // the data isn't owned, views are never coalesced
+        }
+
+        _coalescingIndexes.clear();
+
+        for (const auto &[removedType, removedStream] : _componentRemovedStreams._data)
+        {
+            if (removedType == type)
+            {
+                for (uiw index = 0, size = removedStream->entityIds.size(); index < size; ++index)
+                {
+                    ComponentID componentID = removedStream->componentIds.size() ? removedStream->componentIds[index] : ComponentID{};
+                    _coalescingIndexes.emplace(componentKey(removedStream->entityIds[index], componentID), ui32_max);
+                }
+            }
+        }
+
+        bool isUnique = stream->componentIds.empty();
+        ui32 target = 0;
+        for (uiw index = 0, size = stream->entityIds.size(); index < size; ++index)
+        {
+            EntityID entityID = stream->entityIds[index];
+            ComponentID componentID = isUnique ? ComponentID{} : stream->componentIds[index];
+
+            if (isRemoved(entityID))
+            {
+                continue;
+            }
+
+            auto [it, isInserted] = _coalescingIndexes.emplace(componentKey(entityID, componentID), target);
+            ui32 writeIndex = it->second;
+            if (writeIndex == ui32_max)
+            {
+                continue; // the component is being removed
+            }
+            if (isInserted)
+            {
+                stream->entityIds[target] = entityID;
+                if (isUnique == false)
+                {
+                    stream->componentIds[target] = componentID;
+                }
+                ++target;
+            }
+
+            if (writeIndex != index)
+            {
+                MemOps::Copy(stream->data.get() + writeIndex * desc.sizeOf, stream->data.get() + index * desc.sizeOf, desc.sizeOf);
+            }
+        }
+
+        stream->entityIds.resize(target);
+        if (isUnique == false)
+        {
+            stream->componentIds.resize(target);
+        }
+    }
+
+    // streams must not be empty, drop them and rebuild the indexes
+    auto removeEmpty = [](auto &builder, auto &&isEmpty, auto &&isIndexed)
+    {
+        auto newEnd = std::remove_if(builder._data.begin(), builder._data.end(), [&isEmpty](const auto &entry) { return isEmpty(entry.second); });
+        if (newEnd == builder._data.end())
+        {
+            return;
+        }
+        builder._data.erase(newEnd, builder._data.end());
+        builder._index.Clear();
+        for (uiw index = 0; index < builder._data.size(); ++index)
+        {
+            if (isIndexed(builder._data[index].second))
+            {
+                builder._index.Add(builder._data[index].first.Hash(), static_cast<ui32>(index));
+            }
+        }
+    };
+    auto isAlwaysIndexed = [](const auto &) { return true; };
+
+    removeEmpty(_entityRemovedStreams, [](const auto &stream) { return stream->empty(); }, isAlwaysIndexed);
+    removeEmpty(_componentAddedStreams, [](const auto &stream) { return stream->empty(); }, isAlwaysIndexed);
+    removeEmpty(_componentRemovedStreams, [](const auto &stream) { return stream->entityIds.empty(); }, isAlwaysIndexed);
+    removeEmpty(_componentChangedStreams, [](const auto &descWithStream) { return descWithStream.second->EntityIds().empty(); }, [](const auto &descWithStream) { return descWithStream.second->IsView() == false; });
+}
+
+void MessageStreamComponentChanged::InfoWithData::Detach(const ComponentDescription &desc)
+{
+	ASSUME(IsView() && desc.isUnique);
+	ASSUME(entityIds.empty());
+
+	entityIds.assign(viewEntityIds.begin(), viewEntityIds.end());
+	uiw dataSize = desc.sizeOf * viewEntityIds.size();
+	if (dataSize > dataReserved)
+	{
+		dataReserved = static_cast<ui32>(dataSize);
+		byte *oldPtr = data.release();
+		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, dataReserved, desc.alignmentOf);
+		data.reset(newPtr);
+	}
+	MemOps::Copy(data.get(), viewData, dataSize);
+
+	viewEntityIds = {};
+	viewData = nullptr;
+}
+
+void MessageStreamComponentChanged::InfoWithData::Append(EntityID entityID, const byte *componentData, ComponentID componentID, ui16 sizeOf, ui16 alignmentOf)
+{
+	ASSUME(IsView() == false);
+
+    uiw copyIndex = sizeOf * entityIds.size();
+
+    if (copyIndex + sizeOf > dataReserved)
+    {
+        dataReserved *= 2;
+        dataReserved += sizeOf;
+
+        ASSUME(dataReserved >= copyIndex + sizeOf);
+
+		byte *oldPtr = data.release();
+		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, dataReserved, alignmentOf);
+        data.reset(newPtr);
+    }
+
+    entityIds.emplace_back(entityID);
+	if (componentID)
+	{
+		componentIds.emplace_back(componentID);
+	}
+    MemOps::Copy(data.get() + copyIndex, componentData, sizeOf);
+}
+
+byte *MessageStreamComponentChanged::InfoWithData::AppendRange(Array<const EntityID> ids, Array<const ComponentID> componentIdsToAdd, ui16 sizeOf, ui16 alignmentOf)
+{
+	ASSUME(IsView() == false);
+	ASSUME(componentIdsToAdd.empty() || componentIdsToAdd.size() == ids.size());
+
+    uiw copyIndex = sizeOf * entityIds.size();
+    uiw requiredSize = copyIndex + sizeOf * ids.size();
+
+    if (requiredSize > dataReserved)
+    {
+        dataReserved = static_cast<ui32>(std::max<uiw>(requiredSize, dataReserved * 2));
+
+		byte *oldPtr = data.release();
+		byte *newPtr = Allocator::MallocAlignedRuntime::Reallocate(oldPtr, dataReserved, alignmentOf);
+        data.reset(newPtr);
+    }
+
+    entityIds.insert(entityIds.end(), ids.data(), ids.data() + ids.size());
+	componentIds.insert(componentIds.end(), componentIdsToAdd.data(), componentIdsToAdd.data() + componentIdsToAdd.size());
+    return data.get() + copyIndex;
+}
+
+void MessageStreamComponentChanged::InfoWithData::Reset()
+{
+	ASSUME(IsView() == false);
+	entityIds.clear();
+	componentIds.clear();
+}
+
+void MessageStreamsIndex::Add(ui64 hash, ui32 index)
+{
+	if ((_count + 1) * 2 > _slots.size())
+	{
+		uiw newSize = std::max<uiw>(_slots.size() * 2, 16);
+		vector<Slot> oldSlots = move(_slots);
+		_slots.assign(newSize, Slot{});
+		_shift = oldSlots.empty() ? 60 : _shift - 1; // 64 - log2(newSize)
+		_count = 0;
+
+		for (const Slot &slot : oldSlots)
+		{
+			if (slot.index != ui32_max)
+			{
+				Add(slot.hash, slot.index);
+			}
+		}
+	}
+
+	uiw mask = _slots.size() - 1;
+	uiw slot = SlotFor(hash);
+	while (_slots[slot].index != ui32_max)
+	{
+		slot = (slot + 1) & mask;
+	}
+	_slots[slot] = {hash, index};
+	++_count;
+}
+
+void MessageStreamsIndex::Clear()
+{
+	if (_count)
+	{
+		std::fill(_slots.begin(), _slots.end(), Slot{});
+		_count = 0;
+	}
+}
+
+byte *PrefabInstances::FindColumn(TypeId type) const
+{
+	for (const auto &column : _columns)
+	{
+		if (column.type == type)
+		{
+			ASSUME(!column.isTag);
+			return const_cast<byte *>(column.data);
+		}
+	}
+	SOFTBREAK;
+	return nullptr;
+}
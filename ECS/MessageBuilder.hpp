@@ -3,6 +3,8 @@
 #include "EntityID.hpp"
 #include "Archetype.hpp"
 #include "ComponentArrayBuilder.hpp"
+#include "FrameArena.hpp"
+#include "Prefab.hpp"
 
 namespace ECSTest
 {
@@ -284,6 +286,30 @@ namespace ECSTest
 			vector<ComponentID> componentIds{};
 			unique_ptr<byte[], AlignedMallocDeleter> data{};
             ui32 dataReserved{};
+			// when viewData is set, the stream doesn't own its data and references an archetype group's column instead,
+			// only unique components can be referenced that way, the owner must call Detach before it modifies the column
+			Array<const EntityID> viewEntityIds{};
+			const byte *viewData{};
+
+			[[nodiscard]] bool IsView() const
+			{
+				return viewData != nullptr;
+			}
+
+			[[nodiscard]] Array<const EntityID> EntityIds() const
+			{
+				return IsView() ? viewEntityIds : Array<const EntityID>(entityIds.data(), entityIds.size());
+			}
+
+			[[nodiscard]] const byte *Data() const
+			{
+				return IsView() ? viewData : data.get();
+			}
+
+			void Detach(const ComponentDescription &desc); // copies the referenced data, the stream becomes a regular owning stream
+			void Append(EntityID entityID, const byte *componentData, ComponentID componentID, ui16 sizeOf, ui16 alignmentOf); // can't be used with views
+			[[nodiscard]] byte *AppendRange(Array<const EntityID> ids, Array<const ComponentID> componentIdsToAdd, ui16 sizeOf, ui16 alignmentOf); // returns uninitialized memory for the values, can't be used with views
+			void Reset(); // keeps the allocated memory
         };
 
         shared_ptr<const InfoWithData> _source{};
@@ -293,7 +319,7 @@ namespace ECSTest
 
         MessageStreamComponentChanged(Archetype archetype, const shared_ptr<const InfoWithData> &source, ComponentDescription componentDesc, string_view sourceName) : _archetype(archetype), _source(source), _componentDesc(componentDesc), _sourceName(sourceName)
         {
-            ASSUME(_source->entityIds.size());
+            ASSUME(_source->EntityIds().size());
 			ASSUME(componentDesc.type != TypeId{});
         }
 
@@ -378,7 +404,7 @@ namespace ECSTest
 				}
 				else
 				{
-					return {_source._source->entityIds.data(), _source._source->componentIds.data(), _source._source->data.get()};
+					return {_source._source->EntityIds().data(), _source._source->componentIds.data(), _source._source->Data()};
 				}
 			}
 
@@ -390,7 +416,8 @@ namespace ECSTest
 				}
 				else
 				{
-					return {_source._source->entityIds.data() + _source._source->entityIds.size(), nullptr, nullptr};
+					auto entityIds = _source._source->EntityIds();
+					return {entityIds.data() + entityIds.size(), nullptr, nullptr};
 				}
 			}
 		};
@@ -586,6 +613,98 @@ namespace ECSTest
         }
 	};
 
+    // open addressing index from a stream key (TypeId or Archetype) into MessageStreamsBuilder*::_data,
+    // lets MessageBuilder find the target stream without scanning all of them
+    class MessageStreamsIndex
+    {
+        struct Slot
+        {
+            ui64 hash{};
+            ui32 index = ui32_max; // into _data, ui32_max marks an empty slot
+        };
+
+        vector<Slot> _slots{};
+        ui32 _count{};
+        ui32 _shift{};
+
+        [[nodiscard]] uiw SlotFor(ui64 hash) const
+        {
+            return static_cast<uiw>((hash * 0x9E3779B97F4A7C15ULL) >> _shift); // keys often have zero low bits, so mix the hash
+        }
+
+    public:
+        template <typename Data, typename Key> [[nodiscard]] ui32 Find(const Data &data, const Key &key) const
+        {
+            if (_count == 0)
+            {
+                return ui32_max;
+            }
+
+            ui64 hash = key.Hash();
+            uiw mask = _slots.size() - 1;
+            for (uiw slot = SlotFor(hash); ; slot = (slot + 1) & mask)
+            {
+                const Slot &current = _slots[slot];
+                if (current.index == ui32_max)
+                {
+                    return ui32_max;
+                }
+                if (current.hash == hash && data[current.index].first == key)
+                {
+                    return current.index;
+                }
+            }
+        }
+
+        void Add(ui64 hash, ui32 index); // the key must not be present already
+        void Clear();
+    };
+
+    // recycles stream objects of a MessageBuilder, an object gets reused only after all the message streams that referenced it are gone
+    template <typename T> class MessageStreamsPool
+    {
+        struct Entry
+        {
+            T value{};
+            shared_ptr<FrameArena> arena{}; // keeps the payloads alive while the stream is referenced
+        };
+
+        vector<shared_ptr<Entry>> _entries{};
+        vector<shared_ptr<Entry>> _free{};
+
+    public:
+        [[nodiscard]] shared_ptr<T> Acquire(const shared_ptr<FrameArena> &arena)
+        {
+            shared_ptr<Entry> entry;
+            if (_free.empty())
+            {
+                entry = make_shared<Entry>();
+                _entries.push_back(entry);
+            }
+            else
+            {
+                entry = move(_free.back());
+                _free.pop_back();
+            }
+            entry->arena = arena;
+            return shared_ptr<T>(entry, &entry->value);
+        }
+
+        template <typename Reset> void Recycle(Reset &&reset) // the builder must not reference the acquired objects anymore
+        {
+            _free.clear();
+            for (auto &entry : _entries)
+            {
+                if (entry.use_count() == 1)
+                {
+                    reset(entry->value);
+                    entry->arena = {};
+                    _free.push_back(entry);
+                }
+            }
+        }
+    };
+
     class MessageStreamsBuilderEntityAdded
     {
         friend class SystemsManagerMT;
@@ -594,6 +713,8 @@ namespace ECSTest
         friend UnitTests;
 
         vector<pair<Archetype, shared_ptr<vector<MessageStreamRegisterEntity::EntityWithComponents>>>> _data{};
+        MessageStreamsIndex _index{};
+        MessageStreamsPool<vector<MessageStreamRegisterEntity::EntityWithComponents>> _pool{};
     };
 
     class MessageStreamsBuilderComponentAdded
@@ -604,6 +725,8 @@ namespace ECSTest
         friend UnitTests;
 
         vector<pair<TypeId, shared_ptr<vector<MessageStreamComponentAdded::EntityWithComponents>>>> _data{};
+        MessageStreamsIndex _index{};
+        MessageStreamsPool<vector<MessageStreamComponentAdded::EntityWithComponents>> _pool{};
     };
 
     class MessageStreamsBuilderComponentChanged
@@ -614,6 +737,8 @@ namespace ECSTest
         friend UnitTests;
 
         vector<pair<TypeId, pair<ComponentDescription, shared_ptr<MessageStreamComponentChanged::InfoWithData>>>> _data{};
+        MessageStreamsIndex _index{}; // views aren't indexed, they never receive more changes
+        MessageStreamsPool<MessageStreamComponentChanged::InfoWithData> _pool{}; // views aren't pooled, SystemsManagerST tracks their lifetime
     };
 
     class MessageStreamsBuilderComponentRemoved
@@ -624,6 +749,8 @@ namespace ECSTest
         friend UnitTests;
 
         vector<pair<TypeId, shared_ptr<MessageStreamComponentRemoved::ComponentsInfo>>> _data{};
+        MessageStreamsIndex _index{};
+        MessageStreamsPool<MessageStreamComponentRemoved::ComponentsInfo> _pool{};
     };
 
     class MessageStreamsBuilderEntityRemoved
@@ -634,6 +761,33 @@ namespace ECSTest
         friend UnitTests;
 
 		vector<pair<Archetype, shared_ptr<vector<EntityID>>>> _data{};
+		MessageStreamsIndex _index{};
+		MessageStreamsPool<vector<EntityID>> _pool{};
+    };
+
+    // entities added by MessageBuilder::Instantiate, the components can be overridden in place until the builder is cleared
+    class PrefabInstances
+    {
+		friend class MessageBuilder;
+
+		Array<const EntityID> _entityIds{};
+		Array<const SerializedComponent> _columns{};
+
+		PrefabInstances(Array<const EntityID> entityIds, Array<const SerializedComponent> columns) : _entityIds(entityIds), _columns(columns)
+		{}
+
+		[[nodiscard]] byte *FindColumn(TypeId type) const;
+
+	public:
+		[[nodiscard]] Array<const EntityID> EntityIDs() const
+		{
+			return _entityIds;
+		}
+
+		template <typename T, typename = enable_if_t<T::IsUnique() && T::IsTag() == false>> [[nodiscard]] Array<T> Column() const // the component must be part of the prefab
+		{
+			return {reinterpret_cast<T *>(FindColumn(T::GetTypeId())), _entityIds.size()};
+		}
     };
 
     class MessageBuilder
@@ -642,6 +796,34 @@ namespace ECSTest
         friend class SystemsManagerST;
         friend UnitTests;
 
+		// entities added by SpawnBatch or Instantiate, stored by columns
+		struct EntitiesBatch
+		{
+			ArchetypeFull archetypeFull{};
+			Archetype archetype{};
+			Array<const EntityID> entityIds{}; // allocated from the arena
+			vector<SerializedComponent> columns{}; // data of every column except tags references entityIds.size() components allocated from the arena
+			shared_ptr<FrameArena> arena{};
+		};
+
+		// added by DestroyMatching, AddTagMatching and RemoveTagMatching, applied to whole archetype groups after all the other messages
+		struct MatchingCommand
+		{
+			enum class Action { Destroy, AddTag, RemoveTag };
+
+			Action action{};
+			ComponentDescription tag{}; // not used by Destroy
+			vector<ArchetypeDefiningRequirement> query{};
+		};
+
+		[[nodiscard]] vector<MessageStreamRegisterEntity::EntityWithComponents> &FindOrAddEntityAddedStream(const Archetype &archetype);
+		[[nodiscard]] MessageStreamComponentChanged::InfoWithData &FindOrAddComponentChangedStream(const ComponentDescription &desc);
+		[[nodiscard]] const shared_ptr<FrameArena> &CurrentArena();
+		[[nodiscard]] Array<const EntityID> GenerateEntityIds(uiw count); // allocated from the current arena
+		[[nodiscard]] EntitiesBatch &AllocateEntitiesBatch(const ArchetypeFull &archetype, Array<const SerializedComponent> columns, uiw count); // the columns' data is left uninitialized
+		[[nodiscard]] shared_ptr<vector<MessageStreamRegisterEntity::EntityWithComponents>> EntitiesBatchToStream(const EntitiesBatch &batch); // the components reference the batch's columns
+		void Coalesce(); // merges the messages according to the rules from design.txt, EntityRemovedNoArchetype must be already resolved
+
 		void SetEntityIdGenerator(EntityIDGenerator *generator);
         void SourceName(string_view name);
 		[[nodiscard]] string_view SourceName() const;
@@ -655,6 +837,8 @@ namespace ECSTest
         [[nodiscard]] MessageStreamsBuilderComponentRemoved &ComponentRemovedStreams();
         [[nodiscard]] MessageStreamsBuilderEntityRemoved &EntityRemovedStreams();
         [[nodiscard]] const vector<EntityID> &EntityRemovedNoArchetype();
+		// adds a stream that references the passed data without copying it, the caller is responsible for keeping it alive and unchanged until the stream is detached or destroyed
+		[[nodiscard]] shared_ptr<MessageStreamComponentChanged::InfoWithData> ComponentChangedView(const ComponentDescription &desc, Array<const EntityID> entityIds, const byte *data);
 
     public:
         template <typename T, typename = enable_if_t<T::IsUnique()>> void AddComponent(EntityID entityID, const T &component)
@@ -732,6 +916,72 @@ namespace ECSTest
             static_assert(false_v<T>, "Passed value is not a component");
         }
 
+		// resolves the ComponentChanged stream once, use it when sending many changes of the same type,
+		// the cursor stays valid until the builder is cleared
+		template <typename T> class ComponentChangedCursor
+		{
+			static_assert(T::IsTag() == false, "Tag components cannot be changed");
+
+			MessageStreamComponentChanged::InfoWithData &_entry;
+
+		public:
+			ComponentChangedCursor(MessageStreamComponentChanged::InfoWithData &entry) : _entry(entry)
+			{}
+
+			template <typename E = T, typename = enable_if_t<E::IsUnique()>> void ComponentChanged(EntityID entityID, const T &component)
+			{
+				_entry.Append(entityID, reinterpret_cast<const byte *>(&component), {}, sizeof(T), alignof(T));
+			}
+
+			template <typename E = T, typename = enable_if_t<E::IsUnique() == false>> void ComponentChanged(EntityID entityID, const T &component, ComponentID id)
+			{
+				ASSUME(id);
+				_entry.Append(entityID, reinterpret_cast<const byte *>(&component), id, sizeof(T), alignof(T));
+			}
+		};
+
+		template <typename T, typename = enable_if_t<T::IsTag() == false>> [[nodiscard]] ComponentChangedCursor<T> ComponentChangedStream(uiw countHint = 0)
+		{
+			ComponentDescription desc;
+			desc.type = T::GetTypeId();
+			desc.sizeOf = sizeof(T);
+			desc.alignmentOf = alignof(T);
+			desc.isUnique = T::IsUnique();
+			desc.isTag = false;
+			if (countHint)
+			{
+				ComponentChangedHint(desc, countHint);
+			}
+			return {FindOrAddComponentChangedStream(desc)};
+		}
+
+		// appends the whole span with a single reservation
+		template <typename T, typename = enable_if_t<T::IsUnique() && T::IsTag() == false>> void ComponentChangedRange(Array<const EntityID> entityIds, Array<const T> components)
+		{
+			ASSUME(entityIds.size() == components.size());
+			MemOps::Copy(ComponentChangedReserve<T>(entityIds).data(), components.data(), components.size());
+		}
+
+		template <typename T, typename = enable_if_t<T::IsUnique() == false && T::IsTag() == false>> void ComponentChangedRange(Array<const EntityID> entityIds, Array<const T> components, Array<const ComponentID> ids)
+		{
+			ASSUME(entityIds.size() == components.size());
+			MemOps::Copy(ComponentChangedReserve<T>(entityIds, ids).data(), components.data(), components.size());
+		}
+
+		// returns storage for the new values that must be filled in place, it's valid until another change of that type is sent
+		template <typename T, typename = enable_if_t<T::IsUnique() && T::IsTag() == false>> [[nodiscard]] Array<T> ComponentChangedReserve(Array<const EntityID> entityIds)
+		{
+			byte *data = ComponentChangedReserve(T::Description(), entityIds, {});
+			return {reinterpret_cast<T *>(data), entityIds.size()};
+		}
+
+		template <typename T, typename = enable_if_t<T::IsUnique() == false && T::IsTag() == false>> [[nodiscard]] Array<T> ComponentChangedReserve(Array<const EntityID> entityIds, Array<const ComponentID> ids)
+		{
+			ASSUME(entityIds.size() == ids.size());
+			byte *data = ComponentChangedReserve(T::Description(), entityIds, ids);
+			return {reinterpret_cast<T *>(data), entityIds.size()};
+		}
+
         template <typename T, typename = enable_if_t<T::IsUnique()>> void RemoveComponent(EntityID entityID, const T &) // both for regular unique and tag components
         {
             RemoveComponent(entityID, T::GetTypeId(), {});
@@ -753,15 +1003,42 @@ namespace ECSTest
         }
         
 		EntityID AddEntity(string_view debugName = ""); // archetype will be computed after all the components were added, you can ignore the returned value if you don't want to add any components
+		// adds count entities with the same components, data of every column except tags must contain count components stored contiguously,
+		// only unique components are supported, the returned ids stay valid until the builder is cleared
+		[[nodiscard]] Array<const EntityID> SpawnBatch(Array<const SerializedComponent> columns, uiw count);
+		// the prefab's data is copied into every instance, the prefab itself can be destroyed right after the call,
+		// prefabs with non-unique components are added entity by entity because every instance gets its own ComponentIDs,
+		// debugName is given to every instance
+		PrefabInstances Instantiate(const Prefab &prefab, uiw count, string_view debugName = "");
         void AddComponent(EntityID entityID, const SerializedComponent &sc);
         void ComponentChanged(EntityID entityID, const SerializedComponent &sc);
 		void ComponentChangedHint(const ComponentDescription &desc, uiw count);
+		[[nodiscard]] byte *ComponentChangedReserve(const ComponentDescription &desc, Array<const EntityID> entityIds, Array<const ComponentID> ids);
         void RemoveComponent(EntityID entityID, TypeId type, ComponentID componentID);
         void RemoveEntity(EntityID entityID);
         void RemoveEntity(EntityID entityID, Archetype archetype);
+		// the query uses the same rules as the systems' requirements, see ArchetypeReflector::Satisfies,
+		// the matching entities are processed by whole archetype groups after all the other messages of the frame
+		void DestroyMatching(Array<const ArchetypeDefiningRequirement> query);
+		void AddTagMatching(const ComponentDescription &tag, Array<const ArchetypeDefiningRequirement> query);
+		void RemoveTagMatching(const ComponentDescription &tag, Array<const ArchetypeDefiningRequirement> query);
+
+		template <typename T, typename = enable_if_t<T::IsTag()>> void AddTagMatching(Array<const ArchetypeDefiningRequirement> query)
+		{
+			AddTagMatching(T::Description(), query);
+		}
+
+		template <typename T, typename = enable_if_t<T::IsTag()>> void RemoveTagMatching(Array<const ArchetypeDefiningRequirement> query)
+		{
+			RemoveTagMatching(T::Description(), query);
+		}
     
 	private:
 		EntityIDGenerator *_entityIdGenerator{};
+		// component payloads of the added entities and components are allocated from the current arena,
+		// an arena is reused after Clear only when no queued stream references it anymore
+		vector<shared_ptr<FrameArena>> _arenas{};
+		shared_ptr<FrameArena> _currentArena{};
 		ComponentArrayBuilder _cab{};
 		MessageStreamsBuilderEntityAdded _entityAddedStreams{};
         MessageStreamsBuilderComponentAdded _componentAddedStreams{};
@@ -769,7 +1046,11 @@ namespace ECSTest
         MessageStreamsBuilderComponentRemoved _componentRemovedStreams{};
         MessageStreamsBuilderEntityRemoved _entityRemovedStreams{};
         vector<EntityID> _entityRemovedNoArchetype{};
+		vector<EntitiesBatch> _entitiesBatches{};
+		vector<MatchingCommand> _matchingCommands{};
 		EntityID _currentEntityId{};
         string_view _sourceName{};
+		std::unordered_set<EntityID> _coalescingRemoved{};
+		std::unordered_map<ui64, ui32> _coalescingIndexes{};
 	};
 }
\ No newline at end of file
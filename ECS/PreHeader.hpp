@@ -15,6 +15,7 @@
 #include <cstdarg>
 #include <array>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 #include <cstdlib>
 #include <stack>
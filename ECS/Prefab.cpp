@@ -0,0 +1,57 @@
+#include "PreHeader.hpp"
+#include "Prefab.hpp"
+
+using namespace ECSTest;
+
+Prefab::Prefab(Array<const SerializedComponent> components) : _components(components.begin(), components.end())
+{
+	std::sort(_components.begin(), _components.end(), [](const SerializedComponent &left, const SerializedComponent &right) { return left.type < right.type; });
+
+	uiw size = 0, alignment = 1;
+	for (const auto &component : _components)
+	{
+		ASSUME(component.id.IsValid() == false); // non-unique components get their ComponentIDs when the instances are registered
+		_isUniqueOnly &= component.isUnique;
+		if (component.isTag == false)
+		{
+			size = (size + component.alignmentOf - 1) & ~(component.alignmentOf - 1);
+			size += component.sizeOf;
+			alignment = std::max<uiw>(alignment, component.alignmentOf);
+		}
+	}
+
+	if (size)
+	{
+		_data.reset(Allocator::MallocAlignedRuntime::Allocate(size, alignment));
+	}
+
+	uiw offset = 0;
+	for (auto &component : _components)
+	{
+		if (component.isTag == false)
+		{
+			offset = (offset + component.alignmentOf - 1) & ~(component.alignmentOf - 1);
+			MemOps::Copy(_data.get() + offset, component.data, component.sizeOf);
+			component.data = _data.get() + offset;
+			offset += component.sizeOf;
+		}
+	}
+
+	_archetypeFull = ArchetypeFull::Create<SerializedComponent, ComponentDescription, &SerializedComponent::type, &SerializedComponent::id>(ToArray(_components));
+	_archetype = _archetypeFull.ToShort();
+}
+
+Array<const SerializedComponent> Prefab::Components() const
+{
+	return ToArray(_components);
+}
+
+const ArchetypeFull &Prefab::GetArchetypeFull() const
+{
+	return _archetypeFull;
+}
+
+Archetype Prefab::GetArchetype() const
+{
+	return _archetype;
+}
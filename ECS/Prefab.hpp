@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Archetype.hpp"
+#include "SerializedComponent.hpp"
+
+namespace ECSTest
+{
+    // entity template that is resolved once and then instantiated by MessageBuilder::Instantiate without going through every component again
+    class Prefab
+    {
+		friend class MessageBuilder;
+
+		vector<SerializedComponent> _components{}; // sorted by type, data references _data
+		unique_ptr<byte[], AlignedMallocDeleter> _data{}; // default values of all the components stored as a single row
+		ArchetypeFull _archetypeFull{};
+		Archetype _archetype{};
+		bool _isUniqueOnly = true; // the instances can be added as a single batch
+
+	public:
+		Prefab() = default;
+		explicit Prefab(Array<const SerializedComponent> components); // the data will be copied over
+		Prefab(Prefab &&) = default;
+		Prefab &operator = (Prefab &&) = default;
+
+		[[nodiscard]] Array<const SerializedComponent> Components() const;
+		[[nodiscard]] const ArchetypeFull &GetArchetypeFull() const;
+		[[nodiscard]] Archetype GetArchetype() const;
+    };
+}
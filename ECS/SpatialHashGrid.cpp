@@ -0,0 +1,194 @@
+#include "PreHeader.hpp"
+#include "SpatialHashGrid.hpp"
+
+using namespace ECSTest;
+
+SpatialHashGrid::SpatialHashGrid(f32 cellSize) : _cellSize(cellSize), _cellSizeReciprocal(1.0f / cellSize)
+{
+	ASSUME(cellSize > 0);
+}
+
+ui64 SpatialHashGrid::CellKey(i32 x, i32 y, i32 z)
+{
+	// 21 bits per axis, the coordinates wrap around far away from the origin, which only makes such cells shared
+	constexpr ui64 mask = (1ULL << 21) - 1;
+	return (static_cast<ui64>(x) & mask) | ((static_cast<ui64>(y) & mask) << 21) | ((static_cast<ui64>(z) & mask) << 42);
+}
+
+i32 SpatialHashGrid::CellCoordinate(f32 value) const
+{
+	return static_cast<i32>(std::floor(value * _cellSizeReciprocal));
+}
+
+void SpatialHashGrid::AddToCell(ui32 entryIndex, ui64 cell)
+{
+	auto &indexes = _cells[cell];
+	_entries[entryIndex].cell = cell;
+	_entries[entryIndex].indexInCell = static_cast<ui32>(indexes.size());
+	indexes.push_back(entryIndex);
+}
+
+void SpatialHashGrid::RemoveFromCell(ui32 entryIndex)
+{
+	const Entry &entry = _entries[entryIndex];
+	auto it = _cells.find(entry.cell);
+	ASSUME(it != _cells.end());
+	auto &indexes = it->second;
+
+	ui32 moved = indexes.back();
+	indexes[entry.indexInCell] = moved;
+	_entries[moved].indexInCell = entry.indexInCell;
+	indexes.pop_back();
+
+	// the empty cells are kept, the entities usually come back to them
+}
+
+void SpatialHashGrid::Update(EntityID entityID, const Vector3 &position)
+{
+	Update(Array<const EntityID>(&entityID, 1), Array<const Vector3>(&position, 1));
+}
+
+void SpatialHashGrid::Update(Array<const EntityID> entityIDs, Array<const Vector3> positions)
+{
+	ASSUME(entityIDs.size() == positions.size());
+
+	// the cells are computed in a separate pass that doesn't touch the map, so the compiler can vectorize it
+	_tempCells.resize(positions.size());
+	ui64 *cells = _tempCells.data();
+	f32 reciprocal = _cellSizeReciprocal;
+	for (uiw index = 0; index < positions.size(); ++index)
+	{
+		i32 x = static_cast<i32>(std::floor(positions[index].x * reciprocal));
+		i32 y = static_cast<i32>(std::floor(positions[index].y * reciprocal));
+		i32 z = static_cast<i32>(std::floor(positions[index].z * reciprocal));
+		cells[index] = CellKey(x, y, z);
+	}
+
+	for (uiw index = 0; index < entityIDs.size(); ++index)
+	{
+		ui32 hint = entityIDs[index].Hint();
+		if (hint >= _entryIndexes.size())
+		{
+			_entryIndexes.resize(hint + 1, ui32_max);
+		}
+
+		ui32 &entryIndex = _entryIndexes[hint];
+		if (entryIndex == ui32_max)
+		{
+			entryIndex = static_cast<ui32>(_entries.size());
+			_entries.push_back({entityIDs[index], positions[index]});
+			AddToCell(entryIndex, cells[index]);
+			continue;
+		}
+
+		Entry &entry = _entries[entryIndex];
+		ASSUME(entry.entityID == entityIDs[index]);
+		entry.position = positions[index];
+		if (entry.cell != cells[index])
+		{
+			RemoveFromCell(entryIndex);
+			AddToCell(entryIndex, cells[index]);
+		}
+	}
+}
+
+void SpatialHashGrid::Remove(EntityID entityID)
+{
+	ui32 hint = entityID.Hint();
+	if (hint >= _entryIndexes.size() || _entryIndexes[hint] == ui32_max)
+	{
+		return;
+	}
+
+	ui32 entryIndex = _entryIndexes[hint];
+	ASSUME(_entries[entryIndex].entityID == entityID);
+	RemoveFromCell(entryIndex);
+	_entryIndexes[hint] = ui32_max;
+
+	// move the last entry into the freed place
+	ui32 lastIndex = static_cast<ui32>(_entries.size() - 1);
+	if (entryIndex != lastIndex)
+	{
+		Entry &last = _entries[lastIndex];
+		_cells.find(last.cell)->second[last.indexInCell] = entryIndex;
+		_entryIndexes[last.entityID.Hint()] = entryIndex;
+		_entries[entryIndex] = last;
+	}
+	_entries.pop_back();
+}
+
+void SpatialHashGrid::Clear()
+{
+	_entries.clear();
+	_entryIndexes.clear();
+	_cells.clear();
+}
+
+void SpatialHashGrid::QueryRadius(const Vector3 &center, f32 radius, vector<EntityID> &output) const
+{
+	ASSUME(radius >= 0);
+
+	i32 fromX = CellCoordinate(center.x - radius), toX = CellCoordinate(center.x + radius);
+	i32 fromY = CellCoordinate(center.y - radius), toY = CellCoordinate(center.y + radius);
+	i32 fromZ = CellCoordinate(center.z - radius), toZ = CellCoordinate(center.z + radius);
+	f32 radiusSquared = radius * radius;
+
+	for (i32 z = fromZ; z <= toZ; ++z)
+	{
+		for (i32 y = fromY; y <= toY; ++y)
+		{
+			for (i32 x = fromX; x <= toX; ++x)
+			{
+				auto it = _cells.find(CellKey(x, y, z));
+				if (it == _cells.end())
+				{
+					continue;
+				}
+
+				for (ui32 entryIndex : it->second)
+				{
+					const Entry &entry = _entries[entryIndex];
+					f32 dx = entry.position.x - center.x;
+					f32 dy = entry.position.y - center.y;
+					f32 dz = entry.position.z - center.z;
+					if (dx * dx + dy * dy + dz * dz <= radiusSquared)
+					{
+						output.push_back(entry.entityID);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::QueryRadius(Array<const Vector3> centers, f32 radius, vector<EntityID> &output, vector<ui32> &offsets) const
+{
+	offsets.clear();
+	offsets.reserve(centers.size() + 1);
+	for (const Vector3 &center : centers)
+	{
+		offsets.push_back(static_cast<ui32>(output.size()));
+		QueryRadius(center, radius, output);
+	}
+	offsets.push_back(static_cast<ui32>(output.size()));
+}
+
+optional<Vector3> SpatialHashGrid::Find(EntityID entityID) const
+{
+	ui32 hint = entityID.Hint();
+	if (hint >= _entryIndexes.size() || _entryIndexes[hint] == ui32_max)
+	{
+		return nullopt;
+	}
+	return _entries[_entryIndexes[hint]].position;
+}
+
+uiw SpatialHashGrid::Size() const
+{
+	return _entries.size();
+}
+
+f32 SpatialHashGrid::CellSize() const
+{
+	return _cellSize;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "EntityID.hpp"
+
+namespace ECSTest
+{
+    // uniform hash grid of entity positions, used to answer "entities within radius R of P" without going through every entity,
+    // the positions are updated incrementally, entities are identified by their hints
+    class SpatialHashGrid
+    {
+		struct Entry
+		{
+			EntityID entityID{};
+			Vector3 position{};
+			ui64 cell{};
+			ui32 indexInCell{};
+		};
+
+		f32 _cellSize{};
+		f32 _cellSizeReciprocal{};
+		vector<Entry> _entries{};
+		vector<ui32> _entryIndexes{}; // EntityID's hint -> index within _entries, ui32_max if the entity isn't stored
+		std::unordered_map<ui64, vector<ui32>> _cells{}; // cell key -> indexes within _entries
+		vector<ui64> _tempCells{};
+
+		[[nodiscard]] static ui64 CellKey(i32 x, i32 y, i32 z);
+		[[nodiscard]] i32 CellCoordinate(f32 value) const;
+		void AddToCell(ui32 entryIndex, ui64 cell);
+		void RemoveFromCell(ui32 entryIndex);
+
+	public:
+		static constexpr f32 defaultCellSize = 8.0f;
+
+		explicit SpatialHashGrid(f32 cellSize = defaultCellSize); // queries with radius about the cell size are the most efficient
+
+		void Update(EntityID entityID, const Vector3 &position); // adds the entity if it's not stored yet
+		void Update(Array<const EntityID> entityIDs, Array<const Vector3> positions); // the cells are computed for the whole batch at once
+		void Remove(EntityID entityID); // does nothing if the entity isn't stored
+		void Clear();
+
+		// the found entities are appended to output, the order is unspecified
+		void QueryRadius(const Vector3 &center, f32 radius, vector<EntityID> &output) const;
+		// entities around centers[index] are stored in output[offsets[index], offsets[index + 1]), offsets get centers.size() + 1 entries
+		void QueryRadius(Array<const Vector3> centers, f32 radius, vector<EntityID> &output, vector<ui32> &offsets) const;
+
+		[[nodiscard]] optional<Vector3> Find(EntityID entityID) const;
+		[[nodiscard]] uiw Size() const;
+		[[nodiscard]] f32 CellSize() const;
+    };
+}
@@ -5,9 +5,24 @@
 #include "LoggerWrapper.hpp"
 #include "IKeyController.hpp"
 #include "AssetsManager.hpp"
+#include "SpatialHashGrid.hpp"
 
 namespace ECSTest
 {
+    class IDirectQuery;
+
+    struct MessageTypes
+    {
+        static constexpr struct MessageType : EnumCombinable<MessageType, ui32, true>
+        {} _None = MessageType::Create(0),
+            RegisterEntity = MessageType::Create(1 << 0),
+            ComponentAdded = MessageType::Create(1 << 1),
+            ComponentChanged = MessageType::Create(1 << 2),
+            ComponentRemoved = MessageType::Create(1 << 3),
+            UnregisterEntity = MessageType::Create(1 << 4),
+            _All = RegisterEntity.Combined(ComponentAdded).Combined(ComponentChanged).Combined(ComponentRemoved).Combined(UnregisterEntity);
+    };
+
     class System
     {
         shared_ptr<IKeyController> _keyController{};
@@ -24,6 +39,8 @@ namespace ECSTest
 			LoggerWrapper logger;
             IKeyController *keyController;
 			AssetsManager &assetsManager;
+			IDirectQuery *directQuery; // set only for indirect systems, see DirectQuery.hpp
+			SpatialHashGrid &spatialIndex; // empty unless some system maintains it, e.g. from position messages
         };
 
 		struct ComponentRequest
@@ -49,6 +66,7 @@ namespace ECSTest
             std::optional<ui32> entityIDIndex; // direct systems only; indicates whether EntityID array was also requested and if it was, contains its argument index, SubtractiveComponent, RequiredComponent or RequiredComponentAny are not accounted for
 			std::optional<ui32> environmentIndex; // same as for entityIDIndex, but for Environment variable
 			Array<const ArchetypeDefiningRequirement> archetypeDefiningInfoOnly; // contains elements from archetypeDefining, but without the access information
+			Array<const TypeId> changed; // direct systems only; types from Changed arguments, empty if the system doesn't filter the groups by changes
         };
 
 		virtual ~System() = default;
@@ -62,6 +80,10 @@ namespace ECSTest
         [[nodiscard]] IKeyController *GetKeyController();
         [[nodiscard]] const IKeyController *GetKeyController() const;
         void SetKeyController(const shared_ptr<IKeyController> &controller);
+		// queried once on Register, a reactive system is skipped when nothing it depends on changed since its previous execution:
+		// direct systems - the withData columns of the matching archetype groups and the groups' entities, indirect systems - the queued messages,
+		// control actions always wake the system up, use it only for the systems that are pure functions of these inputs
+		[[nodiscard]] virtual bool IsReactive() const { return false; }
 		[[nodiscard]] virtual void ControlInput(Environment &env, const ControlAction &input) { SOFTBREAK; }
         virtual void OnCreate(Environment &env) {}
         virtual void OnInitialized(Environment &env) {}
@@ -70,6 +92,12 @@ namespace ECSTest
 
 	struct BaseIndirectSystem : public System
 	{
+		enum class ComponentChangedPolicy
+		{
+			AllChanges, // every queued ComponentChanged stream is delivered
+			LatestState // queued ComponentChanged streams are merged, only the last value of each component is delivered
+		};
+
 		[[nodiscard]] virtual BaseIndirectSystem *AsIndirectSystem() override final;
 		[[nodiscard]] virtual const BaseIndirectSystem *AsIndirectSystem() const override final;
         virtual void ProcessMessages(System::Environment &env, const MessageStreamRegisterEntity &stream) { SOFTBREAK; }
@@ -78,12 +106,41 @@ namespace ECSTest
         virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentRemoved &stream) { SOFTBREAK; }
         virtual void ProcessMessages(System::Environment &env, const MessageStreamUnregisterEntity &stream) { SOFTBREAK; }
         virtual void Update(Environment &env) { SOFTBREAK; }
+		[[nodiscard]] virtual MessageTypes::MessageType AcceptedMessageTypes() const { return MessageTypes::_All; } // queried once on Register, messages of other types are never queued for the system
+		[[nodiscard]] virtual ComponentChangedPolicy ComponentChangedMessagesPolicy() const { return ComponentChangedPolicy::AllChanges; } // use LatestState if the system skips updates and only cares about the current values
+	};
+
+	// implemented by the manager, lets direct systems split their work between the worker threads
+	class NOVTABLE IParallelFor
+	{
+	protected:
+		~IParallelFor() = default;
+
+	public:
+		using Callback = void (*)(void *context, uiw begin, uiw end);
+
+		virtual void Execute(uiw count, uiw minimalChunk, Callback callback, void *context) = 0; // the calling thread takes part as well, returns when all of [0, count) is processed
 	};
 
 	struct BaseDirectSystem : public System
 	{
+		// a column of an archetype group, the columns of a group are laid out in the order of Accept's arguments,
+		// EntityID and Environment arguments occupy a column too
+		struct GroupColumn
+		{
+			byte *data{}; // nullptr if an optional component is missing
+			ComponentID *ids{}; // used only by non unique components
+			ui32 stride{};
+		};
+
+		struct GroupArguments
+		{
+			const GroupColumn *columns{};
+			ui32 entitiesCount{};
+		};
+
 		[[nodiscard]] virtual BaseDirectSystem *AsDirectSystem() override final;
 		[[nodiscard]] virtual const BaseDirectSystem *AsDirectSystem() const override final;
-		virtual void AcceptUntyped(void **array) = 0;
+		virtual void AcceptGroups(Environment &env, Array<const GroupArguments> groups, IParallelFor &parallelFor) = 0; // calls Accept for each group
 	};
 }
\ No newline at end of file
@@ -90,6 +90,23 @@ namespace ECSTest
 			static constexpr bool isEntityID = false;
 		};
 
+		// reported as required so the argument isn't counted as the one with data
+		template <typename... T> struct GetComponentType<Changed<T...>>
+		{
+			static_assert(sizeof...(T) > 0, "Type list of Changed cannot be empty");
+			using expanded = tuple<T...>;
+			using wrapped = tuple<Changed<T>...>;
+			using type = tuple_element_t<0, expanded>;
+			static constexpr uiw argumentCount = sizeof...(T);
+			static constexpr bool isSubtractive = false;
+			static constexpr bool isArray = false;
+			static constexpr bool isNonUnique = false;
+			static constexpr bool isRequired = true;
+			static constexpr bool isOptional = false;
+			static constexpr bool isRequiredAny = false;
+			static constexpr bool isEntityID = false;
+		};
+
 		template <typename... T> struct GetComponentType<NonUnique<T...>>
 		{
 			using expanded = tuple<T...>;
@@ -255,10 +272,185 @@ namespace ECSTest
 			}
         }
 
-        // used by direct systems to convert void **array into proper function argument types
-        template <typename types, typename T, uiw... Indexes> static FORCEINLINE void CallAccept(T *object, void **array, index_sequence<Indexes...>)
+        // builds a typed argument from a group's column, references and pointers are later taken from the returned object
+        template <typename Types, uiw Index> [[nodiscard]] static FORCEINLINE auto MakeGroupArgument(System::Environment &env, const BaseDirectSystem::GroupArguments &group)
+        {
+            using T = tuple_element_t<Index, Types>;
+            using pureType = remove_cv_t<remove_pointer_t<remove_reference_t<T>>>;
+            using componentType = typename GetComponentType<pureType>::type;
+
+            if constexpr (is_reference_v<T> || is_pointer_v<T>)
+            {
+                constexpr uiw index = GetArgumentIndexInArray<Types, Index>(make_index_sequence<tuple_size_v<Types>>());
+                const auto &column = group.columns[index];
+
+                if constexpr (is_same_v<pureType, System::Environment>)
+                {
+                    return &env;
+                }
+                else if constexpr (GetComponentType<pureType>::isNonUnique)
+                {
+                    uiw count = group.entitiesCount * column.stride;
+                    return pureType({reinterpret_cast<componentType *>(column.data), count}, {column.ids, count}, column.stride);
+                }
+                else
+                {
+                    return pureType(reinterpret_cast<componentType *>(column.data), group.entitiesCount);
+                }
+            }
+            else
+            {
+                return pureType{};
+            }
+        }
+
+        // converts the object returned by MakeGroupArgument into a properly typed T argument
+        template <typename Types, uiw Index, typename Stored> [[nodiscard]] static FORCEINLINE auto PassGroupArgument(Stored &stored, const BaseDirectSystem::GroupArguments &group) -> decltype(auto)
+        {
+            using T = tuple_element_t<Index, Types>;
+            using pureType = remove_cv_t<remove_pointer_t<remove_reference_t<T>>>;
+
+            if constexpr (is_same_v<pureType, System::Environment>)
+            {
+                if constexpr (is_reference_v<T>)
+                {
+                    return static_cast<T>(*stored);
+                }
+                else
+                {
+                    return static_cast<T>(stored);
+                }
+            }
+            else if constexpr (is_reference_v<T>)
+            {
+                return static_cast<T>(stored);
+            }
+            else if constexpr (is_pointer_v<T>)
+            {
+                constexpr uiw index = GetArgumentIndexInArray<Types, Index>(make_index_sequence<tuple_size_v<Types>>());
+                T result = group.columns[index].data ? &stored : nullptr;
+                return result;
+            }
+            else
+            {
+                return pureType{};
+            }
+        }
+
+        // used by direct systems to call Accept with the arguments built directly from the group's columns
+        template <typename types, typename T, uiw... Indexes> static FORCEINLINE void CallAcceptForGroup(T *object, System::Environment &env, const BaseDirectSystem::GroupArguments &group, index_sequence<Indexes...>)
         {
-			object->Accept(ConvertArgument<types, Indexes>(array)...);
+            tuple<decltype(MakeGroupArgument<types, Indexes>(env, group))...> stored{MakeGroupArgument<types, Indexes>(env, group)...};
+            object->Accept(PassGroupArgument<types, Indexes>(std::get<Indexes>(stored), group)...);
+        }
+
+        // converts an argument of ForEachSystem::Update into the matching argument of Accept
+        template <typename T> struct ForEachArgumentToAccept
+        {
+            using type = conditional_t<is_same_v<T, EntityID>, const Array<EntityID> &, T>; // EntityID is passed by value, otherwise it's RequiredComponent or such
+        };
+
+        template <typename T> struct ForEachArgumentToAccept<T &>
+        {
+            using type = conditional_t<is_same_v<remove_cv_t<T>, System::Environment>, T &, conditional_t<is_const_v<T>, const Array<remove_cv_t<T>> &, Array<T> &>>;
+        };
+
+        template <typename T> struct ForEachArgumentToAccept<T *>
+        {
+            using type = conditional_t<is_same_v<remove_cv_t<T>, System::Environment>, T *, conditional_t<is_const_v<T>, const Array<remove_cv_t<T>> *, Array<T> *>>;
+        };
+
+        template <typename SystemType, typename... Types> static auto ForEachToAcceptType(tuple<Types...> *) -> void (SystemType::*)(typename ForEachArgumentToAccept<Types>::type...);
+
+        template <typename SystemType> struct ForEachTypes
+        {
+            using updateTypes = typename FunctionInfo::Info<decltype(&SystemType::Update)>::args;
+            using acceptType = decltype(ForEachToAcceptType<SystemType>(static_cast<updateTypes *>(nullptr)));
+            using acceptTypes = typename FunctionInfo::Info<acceptType>::args;
+        };
+
+        // what ForEachSystem keeps per argument while iterating over the rows of a group
+        template <typename T> struct ForEachColumn
+        {
+            using type = conditional_t<is_same_v<T, EntityID>, const EntityID *__restrict, T>;
+        };
+
+        template <typename T> struct ForEachColumn<T &>
+        {
+            using type = conditional_t<is_same_v<remove_cv_t<T>, System::Environment>, T *, T *__restrict>;
+        };
+
+        template <typename T> struct ForEachColumn<T *>
+        {
+            using type = conditional_t<is_same_v<remove_cv_t<T>, System::Environment>, T *, T *__restrict>;
+        };
+
+        // AcceptTypes are the types returned by ForEachArgumentToAccept, the column indexes are computed using them
+        template <typename Types, typename AcceptTypes, uiw Index> [[nodiscard]] static FORCEINLINE auto MakeForEachColumn(System::Environment &env, const BaseDirectSystem::GroupArguments &group) -> typename ForEachColumn<tuple_element_t<Index, Types>>::type
+        {
+            using T = tuple_element_t<Index, Types>;
+            using column = typename ForEachColumn<T>::type;
+
+            if constexpr (is_same_v<remove_cv_t<remove_pointer_t<remove_reference_t<T>>>, System::Environment>)
+            {
+                return &env;
+            }
+            else if constexpr (is_reference_v<T> || is_pointer_v<T> || is_same_v<T, EntityID>)
+            {
+                constexpr uiw index = GetArgumentIndexInArray<AcceptTypes, Index>(make_index_sequence<tuple_size_v<AcceptTypes>>());
+                return reinterpret_cast<column>(group.columns[index].data);
+            }
+            else
+            {
+                return T{};
+            }
+        }
+
+        template <typename T, typename Column> [[nodiscard]] static FORCEINLINE auto ForEachArgument(Column column, uiw row) -> decltype(auto)
+        {
+            if constexpr (is_same_v<remove_cv_t<remove_pointer_t<remove_reference_t<T>>>, System::Environment>)
+            {
+                if constexpr (is_reference_v<T>)
+                {
+                    return static_cast<T>(*column);
+                }
+                else
+                {
+                    return static_cast<T>(column);
+                }
+            }
+            else if constexpr (is_reference_v<T>)
+            {
+                return static_cast<T>(column[row]);
+            }
+            else if constexpr (is_pointer_v<T>)
+            {
+                T result = column ? column + row : nullptr; // an optional component might be missing
+                return result;
+            }
+            else if constexpr (is_same_v<T, EntityID>)
+            {
+                return column[row];
+            }
+            else
+            {
+                return T{};
+            }
+        }
+
+        // the columns are restrict qualified parameters, so the compiler knows the writes into one column can't change another
+        template <typename Types, typename T, uiw... Indexes> static FORCEINLINE void UpdateRows(T *object, uiw begin, uiw end, index_sequence<Indexes...>, typename ForEachColumn<tuple_element_t<Indexes, Types>>::type... columns)
+        {
+            for (uiw row = begin; row < end; ++row)
+            {
+                object->Update(ForEachArgument<tuple_element_t<Indexes, Types>>(columns, row)...);
+            }
+        }
+
+        // used by IDirectQuery to convert void **array into proper argument types of its callable
+        template <typename types, typename T, uiw... Indexes> static FORCEINLINE void CallCallable(T &callable, void **array, index_sequence<Indexes...>)
+        {
+			callable(ConvertArgument<types, Indexes>(array)...);
         }
 
         // make sure the argument type is correct
@@ -565,8 +757,9 @@ namespace ECSTest
 
 		template <typename T, uiw... Indexes> struct ProcessedArgumentsStruct
 		{
-			using withoutAny = decltype(tuple_cat(declval<conditional_t<GetComponentType<tuple_element_t<Indexes, T>>::isRequiredAny, tuple<>, tuple<tuple_element_t<Indexes, T>>>>()...));
+			using withoutAny = decltype(tuple_cat(declval<conditional_t<GetComponentType<tuple_element_t<Indexes, T>>::isRequiredAny || is_base_of_v<_ChangedComponentBase, tuple_element_t<Indexes, T>>, tuple<>, tuple<tuple_element_t<Indexes, T>>>>()...));
 			using onlyAny = decltype(tuple_cat(declval<conditional_t<GetComponentType<tuple_element_t<Indexes, T>>::isRequiredAny == false, tuple<>, tuple<tuple_element_t<Indexes, T>>>>()...));
+			using onlyChanged = decltype(tuple_cat(declval<conditional_t<is_base_of_v<_ChangedComponentBase, tuple_element_t<Indexes, T>> == false, tuple<>, tuple<tuple_element_t<Indexes, T>>>>()...));
 		};
 
 		template <typename T, uiw... Indexes> [[nodiscard]] static constexpr ProcessedArgumentsStruct<T, Indexes...> TransformArguments(index_sequence<Indexes...>)
@@ -690,6 +883,24 @@ namespace ECSTest
 			}
 		}
 
+		template <typename T, uiw... Indexes> [[nodiscard]] static constexpr auto ChangedGroupToTuple(index_sequence<Indexes...>)
+		{
+			return tuple<decltype(tuple_element_t<Indexes, typename GetComponentType<T>::expanded>::GetTypeId())...>(tuple_element_t<Indexes, typename GetComponentType<T>::expanded>::GetTypeId()...);
+		}
+
+		template <typename T, uiw... Indexes> [[nodiscard]] static constexpr auto ChangedToTypeIds(index_sequence<Indexes...>)
+		{
+			constexpr auto converted = Funcs::TupleToArray(tuple_cat(ChangedGroupToTuple<tuple_element_t<Indexes, T>>(make_index_sequence<GetComponentType<tuple_element_t<Indexes, T>>::argumentCount>())...));
+			if constexpr (converted.empty())
+			{
+				return array<TypeId, 0>{};
+			}
+			else
+			{
+				return converted;
+			}
+		}
+
 		template <uiw NonAnySize, uiw AnySize> [[nodiscard]] static constexpr array<ArchetypeDefiningRequirement, NonAnySize + AnySize > ToArchetypeDefiningRequirement(const array<System::ComponentRequest, NonAnySize> &nonAnyComponents, const array<pair<TypeId, ui32>, AnySize> &anyComponents)
 		{
 			array<ArchetypeDefiningRequirement, NonAnySize + AnySize> output{};
@@ -720,6 +931,7 @@ namespace ECSTest
 			using transformedTypes = decltype(TransformArguments<typesWithoutEntityID>(make_index_sequence<tuple_size_v<typesWithoutEntityID>>()));
 			using withoutAny = typename transformedTypes::withoutAny;
 			using onlyAny = typename transformedTypes::onlyAny;
+			using onlyChanged = typename transformedTypes::onlyChanged;
 			using withoutAnyUnpacked = typename decltype(UnpackArguments<withoutAny>(make_index_sequence<tuple_size_v<withoutAny>>()))::unpacked;
 
 			constexpr auto componentsArray = TupleToComponentsArray<withoutAnyUnpacked>(make_index_sequence<tuple_size_v<withoutAnyUnpacked>>());
@@ -738,6 +950,7 @@ namespace ECSTest
 			constexpr auto archetypeDefining = FindMatchingComponents<FindMatchingComponentsCount(sorted, make_array(rfc::RequiredWithData, rfc::Required, rfc::Subtractive))>(sorted, make_array(rfc::RequiredWithData, rfc::Required, rfc::Subtractive));
 			constexpr auto requiredAnyArguments = RequiredAnyToComponentsArray<onlyAny>(make_index_sequence<tuple_size_v<onlyAny>>());
 			constexpr auto archetypeDefiningInfoOnly = ToArchetypeDefiningRequirement(archetypeDefining, requiredAnyArguments);
+			constexpr auto changed = ChangedToTypeIds<onlyChanged>(make_index_sequence<tuple_size_v<onlyChanged>>());
 
 			return tuple
 			{
@@ -754,7 +967,8 @@ namespace ECSTest
 				argumentPassingOrder,
 				entityIDIndex.first,
 				environmentIndex.first,
-				archetypeDefiningInfoOnly
+				archetypeDefiningInfoOnly,
+				changed
 			};
 		}
 
@@ -775,7 +989,8 @@ namespace ECSTest
 				ToArray(get<10>(requestedComponentsTuple)), // argumentPassingOrder
 				get<11>(requestedComponentsTuple), // entityIDIndex
 				get<12>(requestedComponentsTuple), // environmentIndex
-				ToArray(get<13>(requestedComponentsTuple)) // archetypeDefiningInfoOnly
+				ToArray(get<13>(requestedComponentsTuple)), // archetypeDefiningInfoOnly
+				ToArray(get<14>(requestedComponentsTuple)) // changed
 			};
 		}
     };
@@ -804,6 +1019,7 @@ namespace ECSTest
 			static constexpr Requests requestedComponentsArray = _SystemAuxFuncs::ComponentsTupleToRequests(requestedComponentsTuple);
 			static_assert(requestedComponentsArray.entityIDIndex == nullopt, "Indirect systems cannot request EntityID");
 			static_assert(requestedComponentsArray.environmentIndex == nullopt, "Indirect systems cannot request Environment");
+			static_assert(requestedComponentsArray.changed.size() == 0, "Indirect systems receive the changes as messages, they cannot use Changed");
 			return requestedComponentsArray;
 		}
 	};
@@ -833,11 +1049,86 @@ namespace ECSTest
 			return requestedComponentsArray;
 		}
 
-		virtual void AcceptUntyped(void **array) override final
+		virtual void AcceptGroups(Environment &env, Array<const GroupArguments> groups, IParallelFor &parallelFor) override final
 		{
 			using types = typename FunctionInfo::Info<decltype(&SystemType::Accept)>::args;
 			static constexpr uiw count = tuple_size_v<types>;
-			_SystemAuxFuncs::CallAccept<types>(static_cast<SystemType *>(this), array, make_index_sequence<count>());
+			auto *object = static_cast<SystemType *>(this);
+			for (const GroupArguments &group : groups)
+			{
+				_SystemAuxFuncs::CallAcceptForGroup<types>(object, env, group, make_index_sequence<count>());
+			}
+		}
+	};
+
+	// per entity flavour of DirectSystem, instead of Accept the system defines Update that is called for each matching entity,
+	// components are passed as references (or pointers if optional), EntityID by value, RequiredComponent and such are allowed too,
+	// when isParallel is true, the rows are split between the worker threads, such systems can't request Environment
+	template <typename SystemType, bool isParallel = false> struct ForEachSystem : public BaseDirectSystem, public TypeIdentifiable<SystemType>
+	{
+	private:
+		// SystemType is incomplete here, so the types are resolved only within the methods
+		using Types = _SystemAuxFuncs::ForEachTypes<SystemType>;
+
+		static constexpr uiw minimalRowsPerThread = 1024; // smaller groups aren't worth splitting
+
+		struct RowsContext
+		{
+			SystemType *object;
+			System::Environment *env;
+			const GroupArguments *group;
+		};
+
+		// the group's columns are looked up once, before iterating over its rows
+		template <uiw... Indexes> static FORCEINLINE void UpdateGroupRows(const RowsContext &context, uiw begin, uiw end, index_sequence<Indexes...> indexes)
+		{
+			using updateTypes = typename Types::updateTypes;
+			_SystemAuxFuncs::UpdateRows<updateTypes>(context.object, begin, end, indexes, _SystemAuxFuncs::MakeForEachColumn<updateTypes, typename Types::acceptTypes, Indexes>(*context.env, *context.group)...);
+		}
+
+	public:
+		[[nodiscard]] static constexpr auto AcquireRequestedComponents()
+		{
+			return _SystemAuxFuncs::AcquireRequestedComponents<typename Types::acceptType>();
+		}
+
+		[[nodiscard]] virtual TypeId GetTypeId() const override final
+		{
+			return TypeIdentifiable<SystemType>::GetTypeId();
+		}
+
+		[[nodiscard]] virtual string_view GetTypeName() const override final
+		{
+			return TypeIdentifiable<SystemType>::GetTypeName();
+		}
+
+		[[nodiscard]] virtual const Requests &RequestedComponents() const override final
+		{
+			static constexpr auto requestedComponentsTuple = AcquireRequestedComponents();
+			static constexpr Requests requestedComponentsArray = _SystemAuxFuncs::ComponentsTupleToRequests(requestedComponentsTuple);
+			static_assert(!isParallel || requestedComponentsArray.environmentIndex == nullopt, "Parallel ForEachSystem cannot request Environment");
+			return requestedComponentsArray;
+		}
+
+		virtual void AcceptGroups(Environment &env, Array<const GroupArguments> groups, IParallelFor &parallelFor) override final
+		{
+			for (const GroupArguments &group : groups)
+			{
+				RowsContext context{static_cast<SystemType *>(this), &env, &group};
+
+				if constexpr (isParallel)
+				{
+					auto callback = [](void *context, uiw begin, uiw end)
+					{
+						UpdateGroupRows(*static_cast<const RowsContext *>(context), begin, end, make_index_sequence<tuple_size_v<typename Types::updateTypes>>());
+					};
+					parallelFor.Execute(group.entitiesCount, minimalRowsPerThread, callback, &context);
+				}
+				else
+				{
+					UpdateGroupRows(context, 0, group.entitiesCount, make_index_sequence<tuple_size_v<typename Types::updateTypes>>());
+				}
+			}
 		}
 	};
 }
\ No newline at end of file
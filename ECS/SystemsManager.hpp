@@ -3,6 +3,7 @@
 #include "System.hpp"
 #include "IEntitiesStream.hpp"
 #include "WokerThread.hpp"
+#include "ControlsRing.hpp"
 
 namespace ECSTest
 {
@@ -34,6 +35,7 @@ namespace ECSTest
             ui32 indirectSystems{};
             optional<TimeDifference> executionStep{};
 			TimeDifference timeSpentExecuting{};
+			ui32 skippedExecutions{}; // executions of the reactive systems that were skipped because their inputs didn't change
         };
 
         struct ManagerInfo
@@ -42,6 +44,13 @@ namespace ECSTest
             TimeDifference timeSinceStart{};
         };
 
+        using SortKeyFunction = std::function<ui64(const void *component)>; // receives the first component of that type of each entity
+
+        template <typename T, typename F> void SetSortKey(F &&keyFunction)
+        {
+            return SetSortKeyUntyped(T::GetTypeId(), [keyFunction = std::forward<F>(keyFunction)](const void *component) -> ui64 { return keyFunction(*static_cast<const T *>(component)); });
+        }
+
         template <typename T, typename... Args> void Register(Pipeline pipeline, Args &&... args)
         {
             return Register(std::make_unique<T>(std::forward<Args>(args)...), pipeline);
@@ -77,6 +86,15 @@ namespace ECSTest
         [[nodiscard]] virtual PipelineInfo GetPipelineInfo(Pipeline pipeline) const = 0;
         [[nodiscard]] virtual ManagerInfo GetManagerInfo() const = 0;
         virtual void SetLogger(const shared_ptr<LoggerType> &logger) = 0;
+        virtual void SetMessageCoalescing(bool isEnabled) = 0; // redundant messages produced by the systems within a frame get merged before they're applied, disabled by default
+        virtual void SetComponentChangedPartitioning(bool isEnabled) = 0; // ComponentChanged messages get sorted by their location before they're applied and delivered as one stream per archetype, disabled by default
+        virtual void SetParallelComponentChangedThreshold(uiw threshold) = 0; // fewer ComponentChanged messages per frame than that are applied by the scheduler thread alone, the rest are split between the workers, 16384 by default
+        // entities of the archetype groups that have such component get sorted by the key between the frames, a few groups per frame,
+        // for example by mesh and material so the renderer draws in batches, must be called before Start
+        virtual void SetSortKeyUntyped(TypeId componentType, SortKeyFunction keyFunction) = 0;
+        // the actions pushed into the ring by any thread are delivered to every system with a key controller,
+        // the ring is drained at the start of each pipeline's frame, must be called before Start, nullptr to disable
+        virtual void SetInputRing(const shared_ptr<ControlsRing> &ring) = 0;
         virtual void Register(unique_ptr<System> system, Pipeline pipeline) = 0;
         virtual void Unregister(TypeId systemType) = 0;
         virtual void Start(AssetsManager &&assetsManager, EntityIDGenerator &&idGenerator, vector<WorkerThread> &&workers, vector<unique_ptr<IEntitiesStream>> &&streams) = 0;
@@ -1,6 +1,10 @@
 #include "PreHeader.hpp"
 #include "SystemsManagerST.hpp"
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <xmmintrin.h>
+#endif
+
 namespace ECSTest
 {
     class ECSEntitiesST : public IEntitiesStream
@@ -86,6 +90,33 @@ SystemsManagerST::SystemsManagerST(const shared_ptr<LoggerType> &logger) : _logg
     }
 }
 
+void SystemsManagerST::SetMessageCoalescing(bool isEnabled)
+{
+    _isCoalescingMessages = isEnabled;
+}
+
+void SystemsManagerST::SetComponentChangedPartitioning(bool isEnabled)
+{
+    _isPartitioningComponentChanged = isEnabled;
+}
+
+void SystemsManagerST::SetParallelComponentChangedThreshold(uiw threshold)
+{
+    _parallelComponentChangedThreshold = threshold;
+}
+
+void SystemsManagerST::SetSortKeyUntyped(TypeId componentType, SortKeyFunction keyFunction)
+{
+	ASSUME(IsRunning() == false);
+	_sortKeys[componentType] = move(keyFunction);
+}
+
+void SystemsManagerST::SetInputRing(const shared_ptr<ControlsRing> &ring)
+{
+	ASSUME(IsRunning() == false);
+	_inputRing = ring;
+}
+
 shared_ptr<SystemsManagerST> SystemsManagerST::New(const shared_ptr<LoggerType> &logger)
 {
     struct Inherited : public SystemsManagerST
@@ -134,6 +165,7 @@ auto SystemsManagerST::GetPipelineInfo(Pipeline pipeline) const -> PipelineInfo
     info.indirectSystems = static_cast<ui32>(pipelineData.indirectSystems.size());
     info.executionStep = pipelineData.executionStep;
 	info.timeSpentExecuting = pipelineData.timeSpentExecuting;
+	info.skippedExecutions = pipelineData.skippedExecutions;
 
     return info;
 }
@@ -239,23 +271,34 @@ void SystemsManagerST::Register(unique_ptr<System> system, Pipeline pipeline)
 
 	_archetypeReflector.StartTrackingMatchingArchetypes(reinterpret_cast<uiw>(system.get()), requestedComponents.archetypeDefiningInfoOnly);
 
-    auto addSystem = [&pipelineData](auto &managed, auto *system)
+    auto addSystem = [this, &pipelineData](auto &managed, auto *system)
     {
         managed.executedAt = pipelineData.executionFrame - 1;
+        managed.controlsCursor = _controlsLogStart + _controlsLog.size(); // the actions sent before the registration are not delivered
         managed.system.reset(system);
+        managed.isReactive = managed.system->IsReactive();
     };
     
     if (isDirectSystem)
 	{
 		ManagedDirectSystem direct;
         addSystem(direct, system.release()->AsDirectSystem());
+		if (direct.isReactive)
+		{
+			for (const System::ComponentRequest &request : requestedComponents.withData)
+			{
+				direct.inputTypes.push_back(request.type);
+			}
+		}
 		pipelineData.directSystems.emplace_back(move(direct));
 	}
 	else
 	{
 		ManagedIndirectSystem indirect;
         addSystem(indirect, system.release()->AsIndirectSystem());
+		indirect.acceptedMessageTypes = indirect.system->AcceptedMessageTypes();
 		pipelineData.indirectSystems.emplace_back(move(indirect));
+		RebuildMessageRoutes();
 	}
 }
 
@@ -302,6 +345,7 @@ void SystemsManagerST::Unregister(TypeId systemType)
 			if (managed.system->GetTypeId() == systemType)
 			{
 				_archetypeReflector.StopTrackingMatchingArchetypes(reinterpret_cast<uiw>(managed.system.get()));
+				managed.controlsListener = {}; // must be released while the system's key controller is alive
 
 				auto diff = &managed - &directSystems.front();
 				directSystems.erase(directSystems.begin() + diff);
@@ -314,10 +358,12 @@ void SystemsManagerST::Unregister(TypeId systemType)
 			if (managed.system->GetTypeId() == systemType)
 			{
 				_archetypeReflector.StopTrackingMatchingArchetypes(reinterpret_cast<uiw>(managed.system.get()));
+				managed.controlsListener = {}; // must be released while the system's key controller is alive
 
 				auto diff = &managed - &indirectSystems.front();
 				indirectSystems.erase(indirectSystems.begin() + diff);
 				recomputeWriteComponents(pipeline);
+				RebuildMessageRoutes();
 				return;
 			}
 		}
@@ -353,6 +399,45 @@ static ArchetypeFull ComputeArchetype(Array<const SerializedComponent> component
 	return ArchetypeFull::Create<SerializedComponent, ComponentDescription, &SerializedComponent::type, &SerializedComponent::id>(components);
 }
 
+static void Prefetch(const void *address)
+{
+	#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+	#elif defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address);
+	#endif
+}
+
+// stable LSD radix sort by the second element, only the bytes that are used by the largest value are sorted
+static void SortByRow(vector<pair<ui32, ui32>> &entries, vector<pair<ui32, ui32>> &scratch)
+{
+	ui32 maxRow = 0;
+	for (const auto &entry : entries)
+	{
+		maxRow = std::max(maxRow, entry.second);
+	}
+
+	scratch.resize(entries.size());
+	for (ui32 shift = 0; shift < 32 && (maxRow >> shift); shift += 8)
+	{
+		array<uiw, 256> offsets{};
+		for (const auto &entry : entries)
+		{
+			++offsets[(entry.second >> shift) & 0xFF];
+		}
+		uiw sum = 0;
+		for (auto &offset : offsets)
+		{
+			sum += std::exchange(offset, sum);
+		}
+		for (const auto &entry : entries)
+		{
+			scratch[offsets[(entry.second >> shift) & 0xFF]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
 static void AssignComponentIDs(Array<SerializedComponent> components, ComponentIDGenerator &idGenerator)
 {
 	for (auto &component : components)
@@ -375,10 +460,14 @@ void SystemsManagerST::Start(AssetsManager &&assetsManager, EntityIDGenerator &&
 {
 	ASSUME(_entitiesLocations.empty() && _schedulerThread.get_id() == std::thread::id{});
 
-	if (workers.size())
+	_workers = move(workers);
+	for (auto &worker : _workers)
 	{
-        _logger->Message(LogLevels::Warning, selfName, "Workers aren't used by a single threaded systems manager");
-		workers.clear();
+		worker.SetOnWorkDoneNotifier(_workersDoneNotifier);
+		if (!worker.IsRunning())
+		{
+			worker.Start();
+		}
 	}
 
 	_assetsManager = move(assetsManager);
@@ -441,10 +530,25 @@ void SystemsManagerST::Stop(bool isWaitForStop)
 	_entitiesLocations = {};
 	_archetypeGroups = {};
 	//_archetypeGroupsComponents = {};
-	std::exchange(_archetypeGroupsFull, {});
+	_archetypeGroupsFull = {};
 	_archetypeReflector = {};
+	_trackedDirectQueries = {};
+	_spatialIndex.Clear();
     _entityIdGenerator = {};
     _componentIdGenerator = {};
+	_controlsLog.clear();
+	_controlsLogStart = 0;
+	for (auto &pipeline : _pipelines)
+	{
+		for (auto &managed : pipeline.directSystems)
+		{
+			managed.controlsCursor = 0;
+		}
+		for (auto &managed : pipeline.indirectSystems)
+		{
+			managed.controlsCursor = 0;
+		}
+	}
 }
 
 bool SystemsManagerST::IsRunning() const
@@ -462,12 +566,88 @@ shared_ptr<IEntitiesStream> SystemsManagerST::StreamOut() const
     return make_shared<ECSEntitiesST>(shared_from_this());
 }
 
+void SystemsManagerST::ForEachUntyped(const System::Requests &requests, IDirectQuery::Callback callback, void *context)
+{
+	ASSUME(std::this_thread::get_id() == _schedulerThread.get_id()); // only the systems executed by the scheduler can query the components
+
+	// the requests are static, so their address identifies the query
+	uiw id = reinterpret_cast<uiw>(&requests);
+	if (_trackedDirectQueries.insert(id).second)
+	{
+		_archetypeReflector.StartTrackingMatchingArchetypes(id, requests.archetypeDefiningInfoOnly);
+	}
+
+	// the queries can be nested, so each depth uses its own arguments, they allocate only when the depth is reached for the first time or more arguments are requested
+	if (_directQueryDepth == _directQueryArguments.size())
+	{
+		_directQueryArguments.push_back(make_unique<DirectQueryArguments>());
+	}
+	DirectQueryArguments &arguments = *_directQueryArguments[_directQueryDepth];
+	++_directQueryDepth;
+
+	uiw maxArgs = requests.withData.size() + (requests.entityIDIndex != nullopt);
+	arguments.nonUniqueArgs.reserve(maxArgs);
+	arguments.arrayArgs.reserve(maxArgs);
+	arguments.args.reserve(maxArgs);
+
+	for (const ArchetypeReflector::StoredArchetype *archetype : _archetypeReflector.FindMatchingArchetypes(id))
+	{
+		auto it = _archetypeGroups.find(archetype);
+		ASSUME(it != _archetypeGroups.end());
+
+		for (const ArchetypeGroup &group : it->second)
+		{
+			if (group.entitiesCount == 0)
+			{
+				continue;
+			}
+
+			FillArchetypeGroupArguments(group, requests, nullptr, arguments.nonUniqueArgs, arguments.arrayArgs, arguments.args);
+			callback(context, arguments.args.data());
+		}
+	}
+
+	--_directQueryDepth;
+}
+
+void SystemsManagerST::Execute(uiw count, uiw minimalChunk, IParallelFor::Callback callback, void *context)
+{
+	ASSUME(std::this_thread::get_id() == _schedulerThread.get_id()); // the workers are only available to the systems executed by the scheduler
+	ASSUME(minimalChunk > 0);
+
+	uiw threadsCount = _workers.size() + 1;
+	uiw chunk = std::max(minimalChunk, (count + threadsCount - 1) / threadsCount);
+	if (_workers.empty() || count <= chunk)
+	{
+		callback(context, 0, count);
+		return;
+	}
+
+	uiw chunksCount = (count + chunk - 1) / chunk;
+	std::atomic<uiw> nextChunk{0};
+	auto work = [&nextChunk, chunksCount, chunk, count, callback, context]
+	{
+		for (uiw index = nextChunk++; index < chunksCount; index = nextChunk++)
+		{
+			callback(context, index * chunk, std::min(count, (index + 1) * chunk));
+		}
+	};
+
+	for (uiw index = 0; index + 1 < chunksCount && index < _workers.size(); ++index)
+	{
+		_workers[index].AddWork(work);
+	}
+	work(); // the scheduler thread takes part as well
+
+	std::unique_lock lock{_workersDoneNotifier->first};
+	_workersDoneNotifier->second.wait(lock, [this] { return std::all_of(_workers.begin(), _workers.end(), [](const WorkerThread &worker) { return worker.WorkInProgressCount() == 0; }); });
+}
+
 auto SystemsManagerST::FindArchetypeGroup(const ArchetypeFull &archetype, Array<const SerializedComponent> components) -> ArchetypeGroup &
 {
-	auto searchResult = _archetypeGroupsFull.find(archetype);
-	if (searchResult != _archetypeGroupsFull.end())
+	if (ArchetypeGroup *group = _archetypeGroupsFull.Find(archetype, components))
 	{
-		return searchResult->second;
+		return *group;
 	}
 
 	// such group doesn't exist yet, adding a new one
@@ -476,11 +656,7 @@ auto SystemsManagerST::FindArchetypeGroup(const ArchetypeFull &archetype, Array<
 
 auto SystemsManagerST::AddNewArchetypeGroup(const ArchetypeFull &archetype, Array<const SerializedComponent> components) -> ArchetypeGroup &
 {
-	auto[insertedWhere, insertedResult] = _archetypeGroupsFull.try_emplace(archetype);
-	ASSUME(insertedResult);
-	ArchetypeGroup &group = insertedWhere->second;
-
-	_archetypeGroups[archetype.ToShort()].emplace_back(std::ref(group));
+	ArchetypeGroup &group = _archetypeGroupsFull.Insert(archetype, components);
 
 	vector<TypeId> uniqueTypes;
 	for (const auto &component : components)
@@ -495,8 +671,6 @@ auto SystemsManagerST::AddNewArchetypeGroup(const ArchetypeFull &archetype, Arra
 	}
 	std::sort(uniqueTypes.begin(), uniqueTypes.end());
 
-	group.archetype = archetype;
-
 	group.uniqueTypedComponentsCount = static_cast<ui16>(uniqueTypes.size());
 	group.components = make_unique<ArchetypeGroup::ComponentArray[]>(group.uniqueTypedComponentsCount);
 
@@ -560,18 +734,23 @@ auto SystemsManagerST::AddNewArchetypeGroup(const ArchetypeFull &archetype, Arra
 	// also add that archetype to the library
     uniqueTypes.insert(uniqueTypes.end(), group.tags.get(), group.tags.get() + group.tagsCount);
     std::sort(uniqueTypes.begin(), uniqueTypes.end());
-	_archetypeReflector.AddToLibrary(archetype.ToShort(), move(uniqueTypes));
+	group.reflected = &_archetypeReflector.AddToLibrary(archetype.ToShort(), move(uniqueTypes));
+	_archetypeGroups[group.reflected].emplace_back(std::ref(group));
+	ArchetypeRoutes(archetype.ToShort());
 
 	return group;
 }
 
-void SystemsManagerST::AddEntityToArchetypeGroup(const ArchetypeFull &archetype, ArchetypeGroup &group, EntityID entityId, Array<const SerializedComponent> components, MessageBuilder *messageBuilder)
+void SystemsManagerST::ReserveArchetypeGroupEntities(ArchetypeGroup &group, ui32 count)
 {
     ASSUME(group.entitiesReservedCount);
 
-	if (group.entitiesCount == group.entitiesReservedCount)
+	if (count > group.entitiesReservedCount)
 	{
-		group.entitiesReservedCount *= 2;
+		while (count > group.entitiesReservedCount)
+		{
+			group.entitiesReservedCount *= 2;
+		}
 
 		for (ui16 index = 0; index < group.uniqueTypedComponentsCount; ++index)
 		{
@@ -597,6 +776,13 @@ void SystemsManagerST::AddEntityToArchetypeGroup(const ArchetypeFull &archetype,
 
 		newPtr[group.entitiesReservedCount] = EntityID(); // use an extra entry to speed up predictive lookups
 	}
+}
+
+void SystemsManagerST::AddEntityToArchetypeGroup(const ArchetypeFull &archetype, ArchetypeGroup &group, EntityID entityId, Array<const SerializedComponent> components, MessageBuilder *messageBuilder)
+{
+	DetachComponentChangedViews(&group, {});
+
+	ReserveArchetypeGroupEntities(group, group.entitiesCount + 1);
 
 	optional<std::reference_wrapper<ComponentArrayBuilder>> componentBuilder;
 	if (messageBuilder)
@@ -612,7 +798,7 @@ void SystemsManagerST::AddEntityToArchetypeGroup(const ArchetypeFull &archetype,
 		{
 			for (uiw componentIndex = 0; componentIndex < group.components[index].stride; ++componentIndex)
 			{
-				group.components[index].ids[componentIndex] = ComponentID();
+				group.components[index].ids[group.components[index].stride * group.entitiesCount + componentIndex] = ComponentID();
 			}
 		}
 	}
@@ -679,6 +865,276 @@ void SystemsManagerST::AddEntityToArchetypeGroup(const ArchetypeFull &archetype,
 	_entitiesLocations[entityId.Hint()] = {&group, group.entitiesCount};
 
 	++group.entitiesCount;
+	MarkArchetypeGroupWritten(group);
+}
+
+void SystemsManagerST::AddEntitiesBatchToArchetypeGroup(ArchetypeGroup &group, const MessageBuilder::EntitiesBatch &batch)
+{
+	ui32 count = static_cast<ui32>(batch.entityIds.size());
+
+	DetachComponentChangedViews(&group, {});
+
+	ReserveArchetypeGroupEntities(group, group.entitiesCount + count);
+
+	for (const auto &column : batch.columns)
+	{
+		if (column.isTag)
+		{
+			ASSUME(std::find(group.tags.get(), group.tags.get() + group.tagsCount, column.type) != group.tags.get() + group.tagsCount);
+			continue;
+		}
+
+		auto findResult = std::find_if(group.components.get(), group.components.get() + group.uniqueTypedComponentsCount, [&column](const ArchetypeGroup::ComponentArray &stored) { return stored.type == column.type; });
+		ASSUME(findResult != group.components.get() + group.uniqueTypedComponentsCount);
+		auto &componentArray = *findResult;
+		ASSUME(componentArray.isUnique && componentArray.stride == 1 && componentArray.sizeOf == column.sizeOf);
+
+		MemOps::Copy(componentArray.data.get() + componentArray.sizeOf * group.entitiesCount, column.data, componentArray.sizeOf * count);
+	}
+
+	MemOps::Copy(group.entities.get() + group.entitiesCount, batch.entityIds.data(), count);
+
+	ui32 maxHint = 0;
+	for (EntityID entityId : batch.entityIds)
+	{
+		maxHint = std::max(maxHint, entityId.Hint());
+	}
+	if (maxHint >= _entitiesLocations.size())
+	{
+		_entitiesLocations.resize(maxHint + 1);
+	}
+	for (ui32 index = 0; index < count; ++index)
+	{
+		_entitiesLocations[batch.entityIds[index].Hint()] = {&group, group.entitiesCount + index};
+	}
+
+	group.entitiesCount += count;
+	MarkArchetypeGroupWritten(group);
+}
+
+void SystemsManagerST::MoveArchetypeGroupEntities(ArchetypeGroup &source, ArchetypeGroup &target)
+{
+	ASSUME(&source != &target && source.uniqueTypedComponentsCount == target.uniqueTypedComponentsCount);
+
+	DetachComponentChangedViews(&source, {});
+	DetachComponentChangedViews(&target, {});
+
+	ReserveArchetypeGroupEntities(target, target.entitiesCount + source.entitiesCount);
+
+	for (ui16 index = 0; index < source.uniqueTypedComponentsCount; ++index)
+	{
+		const auto &sourceArray = source.components[index];
+		auto findResult = std::find_if(target.components.get(), target.components.get() + target.uniqueTypedComponentsCount, [&sourceArray](const ArchetypeGroup::ComponentArray &stored) { return stored.type == sourceArray.type; });
+		ASSUME(findResult != target.components.get() + target.uniqueTypedComponentsCount);
+		auto &targetArray = *findResult;
+		ASSUME(targetArray.sizeOf == sourceArray.sizeOf && targetArray.stride == sourceArray.stride);
+
+		MemOps::Copy(targetArray.data.get() + targetArray.sizeOf * targetArray.stride * target.entitiesCount, sourceArray.data.get(), sourceArray.sizeOf * sourceArray.stride * source.entitiesCount);
+		if (!sourceArray.isUnique)
+		{
+			MemOps::Copy(targetArray.ids.get() + targetArray.stride * target.entitiesCount, sourceArray.ids.get(), sourceArray.stride * source.entitiesCount);
+		}
+	}
+
+	MemOps::Copy(target.entities.get() + target.entitiesCount, source.entities.get(), source.entitiesCount);
+	for (ui32 index = 0; index < source.entitiesCount; ++index)
+	{
+		_entitiesLocations[source.entities[index].Hint()] = {&target, target.entitiesCount + index};
+	}
+
+	target.entitiesCount += source.entitiesCount;
+	source.entitiesCount = 0;
+	MarkArchetypeGroupWritten(source);
+	MarkArchetypeGroupWritten(target);
+}
+
+void SystemsManagerST::DestroyArchetypeGroupEntities(ArchetypeGroup &group, MessageBuilder &messageBuilder)
+{
+	DetachComponentChangedViews(&group, {});
+
+	// the whole group is sent as a single UnregisterEntity stream
+	auto stream = messageBuilder._entityRemovedStreams._pool.Acquire({});
+	stream->assign(group.entities.get(), group.entities.get() + group.entitiesCount);
+	messageBuilder._entityRemovedStreams._data.emplace_back(group.archetype.ToShort(), move(stream)); // the index isn't needed anymore at this point
+
+	for (ui32 index = 0; index < group.entitiesCount; ++index)
+	{
+		ui32 hint = group.entities[index].Hint();
+		_entityIdGenerator.Free(EntityID(ui32_max, hint));
+		#ifdef DEBUG
+			_entitiesLocations[hint] = {nullptr, ui32_max};
+		#endif
+	}
+
+	group.entitiesCount = 0;
+	MarkArchetypeGroupWritten(group);
+}
+
+void SystemsManagerST::RetagArchetypeGroup(ArchetypeGroup &group, const ComponentDescription &tag, bool isAdding, MessageBuilder &messageBuilder)
+{
+	ASSUME(group.entitiesCount && _tempComponents.empty());
+
+	// all entities of a group share the layout, so the first one describes the whole group
+	for (ui16 componentTypeIndex = 0; componentTypeIndex < group.uniqueTypedComponentsCount; ++componentTypeIndex)
+	{
+		const auto &row = group.components[componentTypeIndex];
+		for (ui16 nonUniqueIndex = 0; nonUniqueIndex < row.stride; ++nonUniqueIndex)
+		{
+			SerializedComponent serialized;
+			serialized.alignmentOf = row.alignmentOf;
+			serialized.isUnique = row.isUnique;
+			serialized.isTag = false;
+			serialized.sizeOf = row.sizeOf;
+			serialized.type = row.type;
+			serialized.data = row.data.get() + row.sizeOf * nonUniqueIndex;
+			if (!row.isUnique)
+			{
+				serialized.id = row.ids[nonUniqueIndex];
+			}
+			_tempComponents.push_back(serialized);
+		}
+	}
+	for (ui16 tagIndex = 0; tagIndex < group.tagsCount; ++tagIndex)
+	{
+		if (group.tags[tagIndex] == tag.type)
+		{
+			ASSUME(!isAdding);
+			continue;
+		}
+
+		SerializedComponent serialized;
+		serialized.isTag = true;
+		serialized.isUnique = true;
+		serialized.type = group.tags[tagIndex];
+		_tempComponents.push_back(serialized);
+	}
+	if (isAdding)
+	{
+		SerializedComponent serialized;
+		static_cast<ComponentDescription &>(serialized) = tag;
+		_tempComponents.push_back(serialized);
+	}
+
+	DetachComponentChangedViews(&group, {});
+
+	if (isAdding)
+	{
+		// ComponentAdded entries carry every component of the entity, so they're built only if somebody is going to receive them
+		const auto &routes = ComponentRoutes(tag.type);
+		if (std::any_of(routes.begin(), routes.end(), [](const ManagedIndirectSystem *managed) { return managed->acceptedMessageTypes.Contains(MessageTypes::ComponentAdded); }))
+		{
+			const auto &arena = messageBuilder.CurrentArena();
+			auto stream = messageBuilder._componentAddedStreams._pool.Acquire(arena);
+			stream->resize(group.entitiesCount);
+			for (ui32 index = 0; index < group.entitiesCount; ++index)
+			{
+				auto &entry = (*stream)[index];
+				entry.entityID = group.entities[index];
+				entry.cab.SetArena(arena.get());
+				entry.cab.AddComponent(_tempComponents.back());
+				uiw serializedIndex = 0;
+				for (ui16 componentTypeIndex = 0; componentTypeIndex < group.uniqueTypedComponentsCount; ++componentTypeIndex)
+				{
+					const auto &row = group.components[componentTypeIndex];
+					for (ui16 nonUniqueIndex = 0; nonUniqueIndex < row.stride; ++nonUniqueIndex, ++serializedIndex)
+					{
+						SerializedComponent serialized = _tempComponents[serializedIndex];
+						serialized.data += row.sizeOf * row.stride * index;
+						entry.cab.AddComponent(serialized);
+					}
+				}
+				entry.components = move(entry.cab._components);
+				entry.added = entry.components.front();
+			}
+			messageBuilder._componentAddedStreams._data.emplace_back(tag.type, move(stream));
+		}
+	}
+	else
+	{
+		auto stream = messageBuilder._componentRemovedStreams._pool.Acquire({});
+		stream->entityIds.assign(group.entities.get(), group.entities.get() + group.entitiesCount);
+		messageBuilder._componentRemovedStreams._data.emplace_back(tag.type, move(stream));
+	}
+
+	ArchetypeFull archetype = ComputeArchetype(ToArray(_tempComponents));
+	if (ArchetypeGroup *target = _archetypeGroupsFull.Find(archetype, ToArray(_tempComponents)))
+	{
+		MoveArchetypeGroupEntities(group, *target);
+		_tempComponents.clear();
+		return;
+	}
+
+	// there's no group with such archetype yet, so the group itself gets re-keyed, its entities and components stay in place
+	_archetypeGroupsFull.Rekey(group, archetype, ToArray(_tempComponents));
+
+	auto &previousGroups = _archetypeGroups[group.reflected];
+	previousGroups.erase(std::find_if(previousGroups.begin(), previousGroups.end(), [&group](const ArchetypeGroup &stored) { return &stored == &group; }));
+
+	vector<TypeId> types;
+	for (const auto &component : _tempComponents)
+	{
+		if (component.isTag || std::find(types.begin(), types.end(), component.type) == types.end())
+		{
+			types.push_back(component.type);
+		}
+	}
+	group.tagsCount = static_cast<ui16>(std::count_if(_tempComponents.begin(), _tempComponents.end(), [](const SerializedComponent &stored) { return stored.isTag; }));
+	group.tags = make_unique<TypeId[]>(group.tagsCount);
+	std::copy(types.end() - group.tagsCount, types.end(), group.tags.get());
+
+	std::sort(types.begin(), types.end());
+	group.reflected = &_archetypeReflector.AddToLibrary(archetype.ToShort(), move(types));
+	_archetypeGroups[group.reflected].emplace_back(std::ref(group));
+	ArchetypeRoutes(archetype.ToShort());
+
+	_tempComponents.clear();
+}
+
+void SystemsManagerST::ApplyMatchingCommands(MessageBuilder &messageBuilder)
+{
+	for (const auto &command : messageBuilder._matchingCommands)
+	{
+		// the groups can get re-keyed, so they're collected first
+		ASSUME(_tempMatchingGroups.empty());
+		auto masks = _archetypeReflector.Compile(ToArray(command.query));
+		for (const auto &stored : _archetypeGroupsFull.Groups())
+		{
+			ArchetypeGroup &group = *stored;
+			if (group.entitiesCount == 0 || !ArchetypeReflector::Satisfies(*group.reflected, masks))
+			{
+				continue;
+			}
+
+			if (command.action != MessageBuilder::MatchingCommand::Action::Destroy)
+			{
+				bool isTagged = std::find(group.tags.get(), group.tags.get() + group.tagsCount, command.tag.type) != group.tags.get() + group.tagsCount;
+				if (isTagged == (command.action == MessageBuilder::MatchingCommand::Action::AddTag))
+				{
+					continue; // nothing to change
+				}
+			}
+
+			_tempMatchingGroups.push_back(&group);
+		}
+
+		for (ArchetypeGroup *group : _tempMatchingGroups)
+		{
+			switch (command.action)
+			{
+			case MessageBuilder::MatchingCommand::Action::Destroy:
+				DestroyArchetypeGroupEntities(*group, messageBuilder);
+				break;
+			case MessageBuilder::MatchingCommand::Action::AddTag:
+				RetagArchetypeGroup(*group, command.tag, true, messageBuilder);
+				break;
+			case MessageBuilder::MatchingCommand::Action::RemoveTag:
+				RetagArchetypeGroup(*group, command.tag, false, messageBuilder);
+				break;
+			}
+		}
+
+		_tempMatchingGroups.clear();
+	}
 }
 
 void SystemsManagerST::StartScheduler(vector<unique_ptr<IEntitiesStream>> &streams)
@@ -686,6 +1142,7 @@ void SystemsManagerST::StartScheduler(vector<unique_ptr<IEntitiesStream>> &strea
 	ASSUME(_tempMessageBuilder.IsEmpty());
     _tempMessageBuilder.SourceName("Initial Streaming");
 	vector<SerializedComponent> serialized;
+	++_writeVersion; // the streamed entities are newer than anything the systems have seen
 
     auto before = TimeMoment::Now();
 	for (auto &stream : streams)
@@ -711,16 +1168,12 @@ void SystemsManagerST::StartScheduler(vector<unique_ptr<IEntitiesStream>> &strea
 	auto &entityAddedStreams = _tempMessageBuilder.EntityAddedStreams();
 	for (auto &[archetype, messages] : entityAddedStreams._data)
 	{
-		auto reflected = _archetypeReflector.Reflect(archetype);
 		MessageStreamRegisterEntity stream = {archetype, messages, _tempMessageBuilder.SourceName()};
-		for (auto &pipeline : _pipelines)
+		for (auto *managed : ArchetypeRoutes(archetype))
 		{
-			for (auto &managed : pipeline.indirectSystems)
+			if (managed->acceptedMessageTypes.Contains(MessageTypes::RegisterEntity))
 			{
-				if (ArchetypeReflector::Satisfies(reflected, managed.system->RequestedComponents().archetypeDefiningInfoOnly))
-				{
-					managed.messageQueue.registerEntityStreams.push_back(stream);
-				}
+				managed->messageQueue.registerEntityStreams.push_back(stream);
 			}
 		}
 	}
@@ -756,6 +1209,12 @@ void SystemsManagerST::StartScheduler(vector<unique_ptr<IEntitiesStream>> &strea
 		}
 	}
 
+	for (auto &worker : _workers)
+	{
+		worker.Stop();
+		worker.Join();
+	}
+
 	#ifdef PLATFORM_ANDROID
 		DetachCurrentThread();
 	#endif
@@ -838,6 +1297,9 @@ void SystemsManagerST::SchedulerLoop()
         }
     }
 
+    SortArchetypeGroups();
+    TrimControlsLog();
+
     if (!isTimeUpToDate)
     {
         updateTimes(nullptr);
@@ -847,10 +1309,21 @@ void SystemsManagerST::SchedulerLoop()
 
 void SystemsManagerST::ExecutePipeline(PipelineData &pipeline, TimeDifference timeSinceLastFrame)
 {
+    DrainInputRing();
+
     for (auto &managed : pipeline.directSystems)
     {
         ASSUME(_tempMessageBuilder.IsEmpty());
 
+        if (managed.isReactive && managed.executedTimes && IsControlsLogPending(*managed.system, managed.controlsCursor) == false && IsDirectSystemInputChanged(managed) == false)
+        {
+            managed.executedAt = pipeline.executionFrame;
+            ++pipeline.skippedExecutions;
+            continue;
+        }
+
+        ++_writeVersion;
+
         System::Environment env =
         {
             timeSinceLastFrame.ToSec(),
@@ -861,39 +1334,36 @@ void SystemsManagerST::ExecutePipeline(PipelineData &pipeline, TimeDifference ti
             _tempMessageBuilder,
             LoggerWrapper(_logger.get(), managed.system->GetTypeName()),
             managed.system->GetKeyController(),
-			_assetsManager
+			_assetsManager,
+			nullptr,
+			_spatialIndex
         };
         env.messageBuilder.SourceName(managed.system->GetTypeId().Name());
 		env.messageBuilder.SetEntityIdGenerator(&_entityIdGenerator);
 
-        IKeyController::ListenerHandle inputHandle;
-        if (env.keyController)
-        {
-            inputHandle = env.keyController->OnControlAction(std::bind(&System::ControlInput, managed.system.get(), std::ref(env), _1));
-        }
+        _executingSystem = managed.system.get();
+        _executingEnvironment = &env;
 
         managed.executedAt = pipeline.executionFrame;
 
         if (managed.executedTimes == 0)
         {
-            IKeyController::ListenerHandle addToQueueHandle;
-            if (env.keyController)
-            {
-                addToQueueHandle = env.keyController->OnControlAction(std::bind(&SendControlActionToQueue, std::ref(managed.controlsToSendQueue), _1));
-            }
+            ListenToControls(managed.controlsListener, *managed.system);
 
             managed.system->OnCreate(env);
-            PassControlsToOtherSystemsAndClear(managed.controlsToSendQueue, managed.system.get());
             UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
             PassMessagesToIndirectSystemsAndClear(env.messageBuilder, nullptr);
 
             managed.system->OnInitialized(env);
-            PassControlsToOtherSystemsAndClear(managed.controlsToSendQueue, managed.system.get());
             UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
             PassMessagesToIndirectSystemsAndClear(env.messageBuilder, nullptr);
         }
 
-        ExecuteDirectSystem(*managed.system, managed.controlsReceivedQueue, managed.controlsToSendQueue, env);
+        ExecuteDirectSystem(*managed.system, managed.controlsCursor, env, managed.changesSeenAt);
+        managed.changesSeenAt = _writeVersion; // the system's own writes are stamped with this version, so they don't pass its filters
+
+        _executingSystem = nullptr;
+        _executingEnvironment = nullptr;
 
         ++managed.executedTimes;
     }
@@ -902,6 +1372,15 @@ void SystemsManagerST::ExecutePipeline(PipelineData &pipeline, TimeDifference ti
     {
         ASSUME(_tempMessageBuilder.IsEmpty());
 
+        if (managed.isReactive && managed.executedTimes && IsControlsLogPending(*managed.system, managed.controlsCursor) == false && managed.messageQueue.empty())
+        {
+            managed.executedAt = pipeline.executionFrame;
+            ++pipeline.skippedExecutions;
+            continue;
+        }
+
+        ++_writeVersion;
+
         System::Environment env =
         {
             timeSinceLastFrame.ToSec(),
@@ -912,29 +1391,23 @@ void SystemsManagerST::ExecutePipeline(PipelineData &pipeline, TimeDifference ti
             _tempMessageBuilder,
             LoggerWrapper(_logger.get(), managed.system->GetTypeName()),
             managed.system->GetKeyController(),
-			_assetsManager
+			_assetsManager,
+			this,
+			_spatialIndex
         };
         env.messageBuilder.SourceName(managed.system->GetTypeId().Name());
 		env.messageBuilder.SetEntityIdGenerator(&_entityIdGenerator);
 
-        IKeyController::ListenerHandle inputHandle;
-        if (env.keyController)
-        {
-            inputHandle = env.keyController->OnControlAction(std::bind(&System::ControlInput, managed.system.get(), std::ref(env), _1));
-        }
+        _executingSystem = managed.system.get();
+        _executingEnvironment = &env;
 
         managed.executedAt = pipeline.executionFrame;
 
         if (managed.executedTimes == 0)
         {
-            IKeyController::ListenerHandle addToQueueHandle;
-            if (env.keyController)
-            {
-                addToQueueHandle = env.keyController->OnControlAction(std::bind(&SendControlActionToQueue, std::ref(managed.controlsToSendQueue), _1));
-            }
+            ListenToControls(managed.controlsListener, *managed.system);
 
             managed.system->OnCreate(env);
-            PassControlsToOtherSystemsAndClear(managed.controlsToSendQueue, managed.system.get());
             UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
             PassMessagesToIndirectSystemsAndClear(env.messageBuilder, managed.system.get());
 
@@ -943,12 +1416,14 @@ void SystemsManagerST::ExecutePipeline(PipelineData &pipeline, TimeDifference ti
             managed.system->OnInitialized(env);
             auto after = TimeMoment::Now();
             _logger->Message(LogLevels::Info, selfName, "Initializing %*s took %.2lfs\n", static_cast<i32>(managed.system->GetTypeName().size()), managed.system->GetTypeName().data(), (after - before).ToSec_f64());
-            PassControlsToOtherSystemsAndClear(managed.controlsToSendQueue, managed.system.get());
             UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
             PassMessagesToIndirectSystemsAndClear(env.messageBuilder, managed.system.get());
         }
 
-        ExecuteIndirectSystem(*managed.system, managed.messageQueue, managed.controlsReceivedQueue, managed.controlsToSendQueue, env);
+        ExecuteIndirectSystem(*managed.system, managed.messageQueue, managed.controlsCursor, env);
+
+        _executingSystem = nullptr;
+        _executingEnvironment = nullptr;
 
         ++managed.executedTimes;
     }
@@ -970,6 +1445,13 @@ void SystemsManagerST::ProcessMessagesAndClear(BaseIndirectSystem &system, Manag
 	{
 		system.ProcessMessages(env, stream);
 	}
+	for (const auto &latest : messageQueue.latestComponentChanged)
+	{
+		if (latest.info->entityIds.size())
+		{
+			system.ProcessMessages(env, MessageStreamComponentChanged({}, latest.info, latest.desc, selfName));
+		}
+	}
     for (const auto &stream : messageQueue.componentRemovedStreams)
     {
         system.ProcessMessages(env, stream);
@@ -982,15 +1464,9 @@ void SystemsManagerST::ProcessMessagesAndClear(BaseIndirectSystem &system, Manag
     messageQueue.clear();
 }
 
-void SystemsManagerST::ExecuteIndirectSystem(BaseIndirectSystem &system, ManagedIndirectSystem::MessageQueue &messageQueue, ControlsQueue &controlsReceivedQueue, ControlsQueue &controlsToSendQueue, System::Environment &env)
+void SystemsManagerST::ExecuteIndirectSystem(BaseIndirectSystem &system, ManagedIndirectSystem::MessageQueue &messageQueue, ui64 &controlsCursor, System::Environment &env)
 {
-    ProcessControlsQueueAndClear(system, controlsReceivedQueue);
-
-    IKeyController::ListenerHandle addToQueueHandle;
-    if (env.keyController)
-    {
-        addToQueueHandle = env.keyController->OnControlAction(std::bind(&SendControlActionToQueue, std::ref(controlsToSendQueue), _1));
-    }
+    ProcessControlsLog(system, controlsCursor);
 
     ProcessMessagesAndClear(system, messageQueue, env);
 
@@ -1004,296 +1480,812 @@ void SystemsManagerST::ExecuteIndirectSystem(BaseIndirectSystem &system, Managed
         ASSUME(it != requested.end()); // system changed component without requesting write access
     }
 
-    PassControlsToOtherSystemsAndClear(controlsToSendQueue, &system);
     UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
     PassMessagesToIndirectSystemsAndClear(env.messageBuilder, &system);
 }
 
-void SystemsManagerST::ExecuteDirectSystem(BaseDirectSystem &system, ControlsQueue &controlsReceivedQueue, ControlsQueue &controlsToSendQueue, System::Environment &env)
+void SystemsManagerST::FillArchetypeGroupArguments(const ArchetypeGroup &group, const System::Requests &requested, System::Environment *env, vector<NonUnique<byte>> &nonUniqueArgs, vector<Array<byte>> &arrayArgs, vector<void *> &args)
 {
-    ProcessControlsQueueAndClear(system, controlsReceivedQueue);
-
-    IKeyController::ListenerHandle addToQueueHandle;
-    if (env.keyController)
-    {
-        addToQueueHandle = env.keyController->OnControlAction(std::bind(&SendControlActionToQueue, std::ref(controlsToSendQueue), _1));
-    }
-
-    auto &requested = system.RequestedComponents();
+	nonUniqueArgs.clear();
+    arrayArgs.clear();
+    args.clear();
 
-    uiw maxArgs = requested.withData.size() + (requested.entityIDIndex != nullopt) + (requested.environmentIndex != nullopt);
-
-	_tempNonUniqueArgs.reserve(maxArgs);
-    _tempArrayArgs.reserve(maxArgs);
-    _tempArgs.reserve(maxArgs);
-
-    const auto &archetypes = _archetypeReflector.FindMatchingArchetypes(reinterpret_cast<uiw>(&system));
-
-    for (const Archetype &archetype : archetypes)
+    for (const System::ComponentRequest &arg : requested.argumentPassingOrder)
     {
-        auto it = _archetypeGroups.find(archetype);
-        ASSUME(it != _archetypeGroups.end());
-
-        ASSUME(_tempNonUniqueArgs.capacity() >= maxArgs && _tempArgs.capacity() >= maxArgs && _tempArrayArgs.capacity() >= maxArgs); // any unexpected reallocation will break the program
+		ASSUME(arg.requirement == RequirementForComponent::OptionalWithData || arg.requirement == RequirementForComponent::RequiredWithData);
 
-        for (const auto &group : it->second)
+        ui32 index = 0;
+        for (; index < group.uniqueTypedComponentsCount; ++index)
         {
-            if (group.get().entitiesCount == 0)
+            if (group.components[index].type == arg.type)
             {
-                continue;
+                break;
             }
+        }
 
-			_tempNonUniqueArgs.clear();
-            _tempArrayArgs.clear();
-            _tempArgs.clear();
+        bool isFound = index < group.uniqueTypedComponentsCount;
 
-            for (const System::ComponentRequest &arg : requested.argumentPassingOrder)
-            {
-				ASSUME(arg.requirement == RequirementForComponent::OptionalWithData || arg.requirement == RequirementForComponent::RequiredWithData);
+        if (isFound)
+        {
+			const auto &component = group.components[index];
+			ASSUME(Funcs::IsAligned(component.data.get(), component.alignmentOf));
 
-                ui32 index = 0;
-                for (; index < group.get().uniqueTypedComponentsCount; ++index)
-                {
-                    if (group.get().components[index].type == arg.type)
-                    {
-                        break;
-                    }
-                }
+			if (component.isUnique)
+			{
+				arrayArgs.push_back({component.data.get(), group.entitiesCount});
+				args.push_back(&arrayArgs.back());
+			}
+			else
+			{
+				NonUnique<byte> desc =
+				{
+					{component.data.get(), group.entitiesCount * component.stride},
+					{component.ids.get(), group.entitiesCount * component.stride},
+					component.stride
+				};
+				nonUniqueArgs.push_back(desc);
+				args.push_back(&nonUniqueArgs.back());
+			}
+        }
+        else
+        {
+            ASSUME(arg.requirement == RequirementForComponent::OptionalWithData); // should have failed the archetype test if there's no such component
+            args.push_back(nullptr);
+        }
+    }
 
-                bool isFound = index < group.get().uniqueTypedComponentsCount;
+	auto insertIds = [&requested, &group, &arrayArgs, &args]
+	{
+		if (requested.entityIDIndex)
+		{
+			arrayArgs.push_back({reinterpret_cast<byte *>(group.entities.get()), group.entitiesCount});
+			args.insert(args.begin() + *requested.entityIDIndex, &arrayArgs.back());
+		}
+	};
 
-                if (isFound)
-                {
-					const auto &component = group.get().components[index];
-					ASSUME(Funcs::IsAligned(component.data.get(), component.alignmentOf));
+	auto insertEnv = [&requested, env, &args]
+	{
+		if (requested.environmentIndex)
+		{
+			args.insert(args.begin() + *requested.environmentIndex, env);
+		}
+	};
 
-					if (component.isUnique)
-					{
-						_tempArrayArgs.push_back({component.data.get(), group.get().entitiesCount});
-						_tempArgs.push_back(&_tempArrayArgs.back());
-					}
-					else
-					{
-						NonUnique<byte> desc =
-						{
-							{component.data.get(), group.get().entitiesCount * component.stride},
-							{component.ids.get(), group.get().entitiesCount * component.stride},
-							component.stride
-						};
-						_tempNonUniqueArgs.push_back(desc);
-						_tempArgs.push_back(&_tempNonUniqueArgs.back());
-					}
-                }
-                else
-                {
-                    ASSUME(arg.requirement == RequirementForComponent::OptionalWithData); // should have failed the archetype test if there's no such component
-                    _tempArgs.push_back(nullptr);
-                }
-            }
+	if (requested.entityIDIndex < requested.environmentIndex)
+	{
+		insertIds();
+		insertEnv();
+	}
+	else
+	{
+		insertEnv();
+		insertIds();
+	}
+}
+
+void SystemsManagerST::FillArchetypeGroupColumns(const ArchetypeGroup &group, const System::Requests &requested, vector<BaseDirectSystem::GroupColumn> &columns)
+{
+	uiw columnsCount = requested.argumentPassingOrder.size() + (requested.entityIDIndex != nullopt) + (requested.environmentIndex != nullopt);
+	uiw requestIndex = 0;
+
+	for (uiw columnIndex = 0; columnIndex < columnsCount; ++columnIndex)
+	{
+		BaseDirectSystem::GroupColumn &column = columns.emplace_back();
 
-			auto insertIds = [this, &requested, &group]
+		if (columnIndex == requested.entityIDIndex)
+		{
+			column.data = reinterpret_cast<byte *>(group.entities.get());
+			column.stride = 1;
+			continue;
+		}
+		if (columnIndex == requested.environmentIndex)
+		{
+			continue; // the Environment is passed by the system itself
+		}
+
+		const System::ComponentRequest &arg = requested.argumentPassingOrder[requestIndex++];
+		ASSUME(arg.requirement == RequirementForComponent::OptionalWithData || arg.requirement == RequirementForComponent::RequiredWithData);
+
+		auto componentsEnd = group.components.get() + group.uniqueTypedComponentsCount;
+		auto component = std::find_if(group.components.get(), componentsEnd, [&arg](const ArchetypeGroup::ComponentArray &stored) { return stored.type == arg.type; });
+		if (component == componentsEnd)
+		{
+			ASSUME(arg.requirement == RequirementForComponent::OptionalWithData); // should have failed the archetype test if there's no such component
+			continue;
+		}
+
+		ASSUME(Funcs::IsAligned(component->data.get(), component->alignmentOf));
+		column.data = component->data.get();
+		column.ids = component->ids.get();
+		column.stride = component->stride;
+	}
+
+	ASSUME(requestIndex == requested.argumentPassingOrder.size());
+}
+
+bool SystemsManagerST::IsArchetypeGroupChanged(const ArchetypeGroup &group, Array<const TypeId> types, ui64 sinceVersion)
+{
+	for (TypeId type : types)
+	{
+		for (uiw index = 0; index < group.uniqueTypedComponentsCount; ++index)
+		{
+			if (group.components[index].type == type)
 			{
-				if (requested.entityIDIndex)
+				if (group.components[index].writtenAt > sinceVersion)
 				{
-					_tempArrayArgs.push_back({reinterpret_cast<byte *>(group.get().entities.get()), group.get().entitiesCount});
-					_tempArgs.insert(_tempArgs.begin() + *requested.entityIDIndex, &_tempArrayArgs.back());
+					return true;
 				}
-			};
+				break;
+			}
+		}
+	}
+	return false;
+}
+
+void SystemsManagerST::MarkArchetypeGroupWritten(ArchetypeGroup &group)
+{
+	for (uiw index = 0; index < group.uniqueTypedComponentsCount; ++index)
+	{
+		group.components[index].writtenAt = _writeVersion;
+	}
+}
+
+bool SystemsManagerST::IsDirectSystemInputChanged(const ManagedDirectSystem &managed) const
+{
+	// the empty groups are checked too, the system might need to know that their entities are gone
+	for (const ArchetypeReflector::StoredArchetype *archetype : _archetypeReflector.FindMatchingArchetypes(reinterpret_cast<uiw>(managed.system.get())))
+	{
+		auto it = _archetypeGroups.find(archetype);
+		ASSUME(it != _archetypeGroups.end());
 
-			auto insertEnv = [this, &requested, &env]
+		for (const ArchetypeGroup &group : it->second)
+		{
+			if (IsArchetypeGroupChanged(group, ToArray(managed.inputTypes), managed.changesSeenAt))
 			{
-				if (requested.environmentIndex)
-				{
-					_tempArgs.insert(_tempArgs.begin() + *requested.environmentIndex, &env);
-				}
-			};
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void SystemsManagerST::ExecuteDirectSystem(BaseDirectSystem &system, ui64 &controlsCursor, System::Environment &env, ui64 changesSeenAt)
+{
+    ProcessControlsLog(system, controlsCursor);
+
+    auto &requested = system.RequestedComponents();
+
+    uiw columnsCount = requested.argumentPassingOrder.size() + (requested.entityIDIndex != nullopt) + (requested.environmentIndex != nullopt);
+
+    ASSUME(_tempDirectGroups.empty() && _tempGroupColumns.empty() && _tempGroupArguments.empty());
+
+    for (const ArchetypeReflector::StoredArchetype *archetype : _archetypeReflector.FindMatchingArchetypes(reinterpret_cast<uiw>(&system)))
+    {
+        auto it = _archetypeGroups.find(archetype);
+        ASSUME(it != _archetypeGroups.end());
 
-			if (requested.entityIDIndex < requested.environmentIndex)
+        for (ArchetypeGroup &group : it->second)
+        {
+            if (group.entitiesCount == 0)
+            {
+                continue;
+            }
+
+			if (requested.changed.size() && IsArchetypeGroupChanged(group, requested.changed, changesSeenAt) == false)
 			{
-				insertIds();
-				insertEnv();
+				continue;
 			}
-			else
+
+			for (const System::ComponentRequest &arg : requested.writeAccess)
 			{
-				insertEnv();
-				insertIds();
+				DetachComponentChangedViews(&group, arg.type);
 			}
 
-            ASSUME(_tempArgs.size() <= maxArgs);
+			_tempDirectGroups.push_back(&group);
+			FillArchetypeGroupColumns(group, requested, _tempGroupColumns);
+        }
+    }
+
+	// the columns vector is complete, so the pointers into it won't be invalidated
+	for (uiw index = 0; index < _tempDirectGroups.size(); ++index)
+	{
+		_tempGroupArguments.push_back({_tempGroupColumns.data() + index * columnsCount, _tempDirectGroups[index]->entitiesCount});
+	}
+
+	// a single call per frame, the system iterates over the groups itself
+	system.AcceptGroups(env, ToArray(_tempGroupArguments), *this);
+
+	for (const System::ComponentRequest &arg : system.RequestedComponents().writeAccess)
+	{
+		// the changes are sent only if there're indirect systems that accept them
+		const auto &routes = ComponentRoutes(arg.type);
+		bool isRouted = std::any_of(routes.begin(), routes.end(), [](const ManagedIndirectSystem *managed) { return managed->acceptedMessageTypes.Contains(MessageTypes::ComponentChanged); });
 
-            system.AcceptUntyped(_tempArgs.data());
+		for (ArchetypeGroup *groupPointer : _tempDirectGroups)
+		{
+			ArchetypeGroup &group = *groupPointer;
 
-			for (const System::ComponentRequest &arg : system.RequestedComponents().writeAccess)
+			ui32 index = 0;
+			for (; index < group.uniqueTypedComponentsCount; ++index)
 			{
-				ui32 index = 0;
-				for (; index < group.get().uniqueTypedComponentsCount; ++index)
+				if (group.components[index].type == arg.type)
 				{
-					if (group.get().components[index].type == arg.type)
-					{
-						break;
-					}
+					break;
 				}
+			}
 
-                bool isFound = index < group.get().uniqueTypedComponentsCount;
-                if (isFound == false)
-                {
-                    ASSUME(arg.requirement == RequirementForComponent::OptionalWithData); // should have failed the archetype test if there's no such component
-                    continue;
-                }
+            bool isFound = index < group.uniqueTypedComponentsCount;
+            if (isFound == false)
+            {
+                ASSUME(arg.requirement == RequirementForComponent::OptionalWithData); // should have failed the archetype test if there's no such component
+                continue;
+            }
 
-                // check if there're indirect systems that require this component
-                auto isRequestedByIndirect = [this](TypeId type)
-                {
-                    for (auto &pipeline : _pipelines)
-                    {
-                        for (auto &managed : pipeline.indirectSystems)
-                        {
-                            auto otherReq = managed.system->RequestedComponents().withData;
-                            for (auto &c : otherReq)
-                            {
-                                if (c.type == type)
-                                {
-                                    return true;
-                                }
-                            }
-                        }
-                    }
-                    return false;
-                };
-                if (isRequestedByIndirect(arg.type) == false)
-                {
-                    continue;
-                }
+			group.components[index].writtenAt = _writeVersion;
 
-				auto &stored = group.get().components[index];
+            if (isRouted == false)
+            {
+                continue;
+            }
 
-				SerializedComponent serialized;
-				serialized.alignmentOf = stored.alignmentOf;
-				serialized.isUnique = stored.isUnique;
-				serialized.sizeOf = stored.sizeOf;
-				serialized.type = stored.type;
-                serialized.isTag = false;
+			auto &stored = group.components[index];
+
+			if (stored.isUnique)
+			{
+				// the column itself is the changed data, reference it instead of copying
+				ComponentDescription desc;
+				desc.alignmentOf = stored.alignmentOf;
+				desc.isUnique = true;
+				desc.isTag = false;
+				desc.sizeOf = stored.sizeOf;
+				desc.type = stored.type;
+
+				auto info = env.messageBuilder.ComponentChangedView(desc, {group.entities.get(), group.entitiesCount}, stored.data.get());
+				_componentChangedViews.insert_or_assign(info.get(), ComponentChangedView{&group, desc, info});
+				continue;
+			}
+
+			SerializedComponent serialized;
+			serialized.alignmentOf = stored.alignmentOf;
+			serialized.isUnique = stored.isUnique;
+			serialized.sizeOf = stored.sizeOf;
+			serialized.type = stored.type;
+            serialized.isTag = false;
 
-				for (ui32 component = 0; component < group.get().entitiesCount; ++component)
+			for (ui32 component = 0; component < group.entitiesCount; ++component)
+			{
+				EntityID entityID = group.entities[component];
+				for (ui32 stride = 0; stride < stored.stride; ++stride)
 				{
-					EntityID entityID = group.get().entities[component];
-					for (ui32 stride = 0; stride < stored.stride; ++stride)
+					serialized.data = stored.data.get() + stored.sizeOf * component * stored.stride + stride * stored.sizeOf;
+					if (stored.isUnique == false)
 					{
-						serialized.data = stored.data.get() + stored.sizeOf * component * stored.stride + stride * stored.sizeOf;
-						if (stored.isUnique == false)
-						{
-							serialized.id = stored.ids[component * stored.stride + stride];
-                            ASSUME(serialized.id);
-						}
-
-						env.messageBuilder.ComponentChanged(entityID, serialized);
+						serialized.id = stored.ids[component * stored.stride + stride];
+                        ASSUME(serialized.id);
 					}
+
+					env.messageBuilder.ComponentChanged(entityID, serialized);
 				}
 			}
-        }
-    }
+		}
+	}
+
+	_tempDirectGroups.clear();
+	_tempGroupColumns.clear();
+	_tempGroupArguments.clear();
 
-    PassControlsToOtherSystemsAndClear(controlsToSendQueue, &system);
     UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(env.messageBuilder);
     PassMessagesToIndirectSystemsAndClear(env.messageBuilder, nullptr);
 }
 
-void SystemsManagerST::ProcessControlsQueueAndClear(System &system, ControlsQueue &controlsQueue)
+void SystemsManagerST::ListenToControls(IKeyController::ListenerHandle &listener, System &system)
 {
-    if (controlsQueue.size() == 0)
+    if (system.GetKeyController() == nullptr)
     {
         return;
     }
 
-    ASSUME(system.GetKeyController());
+    // registered once, the listener ignores the actions dispatched while other systems are executing
+    listener = system.GetKeyController()->OnControlAction([this, &system](const ControlAction &action)
+    {
+        if (_executingSystem != &system)
+        {
+            return;
+        }
+
+        system.ControlInput(*_executingEnvironment, action);
+
+        if (_isDispatchingControlsLog == false)
+        {
+            _controlsLog.push_back({action, &system});
+        }
+    });
+}
+
+void SystemsManagerST::ProcessControlsLog(System &system, ui64 &controlsCursor)
+{
+    ui64 end = _controlsLogStart + _controlsLog.size();
+    IKeyController *keyController = system.GetKeyController();
+
+    if (keyController)
+    {
+        _isDispatchingControlsLog = true;
+        for (ui64 position = controlsCursor; position < end; ++position)
+        {
+            const ControlsLogEntry &entry = _controlsLog[position - _controlsLogStart];
+            if (entry.sender != &system)
+            {
+                keyController->Dispatch(entry.action);
+            }
+        }
+        _isDispatchingControlsLog = false;
+    }
+
+    controlsCursor = end;
+}
+
+bool SystemsManagerST::IsControlsLogPending(const System &system, ui64 controlsCursor) const
+{
+    if (system.GetKeyController() == nullptr)
+    {
+        return false;
+    }
+
+    for (ui64 position = controlsCursor, end = _controlsLogStart + _controlsLog.size(); position < end; ++position)
+    {
+        if (_controlsLog[position - _controlsLogStart].sender != &system)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-    system.GetKeyController()->Dispatch(controlsQueue);
+void SystemsManagerST::DrainInputRing()
+{
+    if (_inputRing == nullptr)
+    {
+        return;
+    }
 
-    controlsQueue.clear();
+    ControlAction action;
+    while (_inputRing->TryPop(action))
+    {
+        _controlsLog.push_back({move(action), nullptr});
+    }
 }
 
-void SystemsManagerST::PassControlsToOtherSystemsAndClear(ControlsQueue &controlsQueue, System *systemToIgnore)
+void SystemsManagerST::TrimControlsLog()
 {
-    if (controlsQueue.size() == 0)
+    if (_controlsLog.empty())
     {
         return;
     }
 
-    for (auto &pipeline : _pipelines)
+    // the systems without key controllers never read the log
+    ui64 end = _controlsLogStart + _controlsLog.size();
+    ui64 readByAll = end;
+    auto check = [&readByAll](const ManagedSystem &managed, const System &system)
     {
-        for (auto &system : pipeline.directSystems)
+        if (system.GetKeyController())
         {
-            if (system.system.get() != systemToIgnore && system.system->GetKeyController())
-            {
-                system.controlsReceivedQueue.Enqueue(controlsQueue.Actions());
-            }
+            readByAll = std::min(readByAll, managed.controlsCursor);
+        }
+    };
+    for (const auto &pipeline : _pipelines)
+    {
+        for (const auto &managed : pipeline.directSystems)
+        {
+            check(managed, *managed.system);
         }
-        for (auto &system : pipeline.indirectSystems)
+        for (const auto &managed : pipeline.indirectSystems)
         {
-            if (system.system.get() != systemToIgnore && system.system->GetKeyController())
+            check(managed, *managed.system);
+        }
+    }
+
+    _controlsLog.erase(_controlsLog.begin(), _controlsLog.begin() + static_cast<uiw>(readByAll - _controlsLogStart));
+    _controlsLogStart = readByAll;
+}
+
+void SystemsManagerST::RebuildMessageRoutes()
+{
+	_componentRoutes.clear();
+	_archetypeRoutes.clear();
+
+	for (auto &pipeline : _pipelines)
+	{
+		for (auto &managed : pipeline.indirectSystems)
+		{
+			for (const auto &request : managed.system->RequestedComponents().all)
+			{
+				if (request.requirement != RequirementForComponent::Subtractive)
+				{
+					ComponentRoutes(request.type);
+				}
+			}
+		}
+	}
+
+	for (const auto &[archetype, groups] : _archetypeGroups)
+	{
+		ArchetypeRoutes(archetype->archetype);
+	}
+}
+
+auto SystemsManagerST::ComponentRoutes(TypeId type) -> const vector<ManagedIndirectSystem *> &
+{
+	auto it = _componentRoutes.find(type);
+	if (it != _componentRoutes.end())
+	{
+		return it->second;
+	}
+
+	// types that weren't requested explicitly can still be routed to the systems without required components
+	vector<ManagedIndirectSystem *> routes;
+	for (auto &pipeline : _pipelines)
+	{
+		for (auto &managed : pipeline.indirectSystems)
+		{
+			const auto &requested = managed.system->RequestedComponents();
+			auto searchPredicate = [type](const System::ComponentRequest &stored) { return type == stored.type; };
+
+			if (requested.subtractive.find_if(searchPredicate) != requested.subtractive.end())
+			{
+				continue;
+			}
+
+			if (requested.required.empty() ||
+				requested.requiredOrOptional.count_if(searchPredicate))
+			{
+				routes.push_back(&managed);
+			}
+		}
+	}
+	return _componentRoutes.emplace(type, move(routes)).first->second;
+}
+
+auto SystemsManagerST::ArchetypeRoutes(const Archetype &archetype) -> const vector<ManagedIndirectSystem *> &
+{
+	auto it = _archetypeRoutes.find(archetype);
+	if (it != _archetypeRoutes.end())
+	{
+		return it->second;
+	}
+
+	auto reflected = _archetypeReflector.Reflect(archetype);
+	vector<ManagedIndirectSystem *> routes;
+	for (auto &pipeline : _pipelines)
+	{
+		for (auto &managed : pipeline.indirectSystems)
+		{
+			if (ArchetypeReflector::Satisfies(reflected, managed.system->RequestedComponents().archetypeDefiningInfoOnly))
+			{
+				routes.push_back(&managed);
+			}
+		}
+	}
+	return _archetypeRoutes.emplace(archetype, move(routes)).first->second;
+}
+
+void SystemsManagerST::DetachComponentChangedViews(const ArchetypeGroup *group, TypeId type)
+{
+	for (auto it = _componentChangedViews.begin(); it != _componentChangedViews.end(); )
+	{
+		auto &view = it->second;
+
+		bool isMatching = (group == nullptr || view.group == group) && (type == TypeId{} || view.desc.type == type);
+		if (isMatching == false && view.info.expired() == false)
+		{
+			++it;
+			continue;
+		}
+
+		if (auto info = view.info.lock())
+		{
+			info->Detach(view.desc);
+		}
+
+		it = _componentChangedViews.erase(it);
+	}
+}
+
+void SystemsManagerST::PatchComponentAddedMessages(MessageBuilder &messageBuilder)
+{
+    for (auto &[componentType, stream] : messageBuilder.ComponentAddedStreams()._data)
+    {
+        for (auto &info : *stream)
+        {
+			const auto &[group, entityLocationIndex] = _entitiesLocations[info.entityID.Hint()];
+			ASSUME(group->entities[entityLocationIndex] == info.entityID);
+
+            for (ui32 index = 0; index < group->uniqueTypedComponentsCount; ++index)
             {
-                system.controlsReceivedQueue.Enqueue(controlsQueue.Actions());
+                const auto &stored = group->components[index];
+
+                SerializedComponent serialized;
+                serialized.alignmentOf = stored.alignmentOf;
+                serialized.isTag = false;
+                serialized.isUnique = stored.isUnique;
+                serialized.sizeOf = stored.sizeOf;
+                serialized.type = stored.type;
+                
+                for (ui32 stride = 0; stride < stored.stride; ++stride)
+                {
+                    serialized.data = stored.data.get() + stored.sizeOf * entityLocationIndex * stored.stride + stride * stored.sizeOf;
+                    if (!serialized.isUnique)
+                    {
+                        serialized.id = stored.ids[entityLocationIndex * stored.stride + stride];
+                    }
+
+                    info.cab.AddComponent(serialized);
+                }
             }
+
+            info.componentsData = move(info.cab._data);
+            info.components = move(info.cab._components);
+            info.added = info.components.front();
         }
     }
+}
+
+void SystemsManagerST::PatchEntityRemovedArchetypes(MessageBuilder &messageBuilder)
+{
+    for (EntityID id : messageBuilder.EntityRemovedNoArchetype())
+    {
+		const auto &entityLocation = _entitiesLocations[id.Hint()];
+		ASSUME(entityLocation.group->entities[entityLocation.index] == id);
+        messageBuilder.RemoveEntity(id, entityLocation.group->archetype.ToShort());
+    }
+}
+
+uiw SystemsManagerST::PrepareComponentChangedApplyTasks(MessageBuilder &messageBuilder, bool isPartitioning)
+{
+	// streams of different types and entries of different groups write into different columns,
+	// entries of the same group stay within the same task, so repeated changes are applied in order
+	uiw tasksCount = 0;
+	for (const auto &[componentType, descWithStream] : messageBuilder.ComponentChangedStreams()._data)
+	{
+		const auto &[desc, stream] = descWithStream;
+
+		if (stream->IsView())
+		{
+			continue; // already in place
+		}
+
+		DetachComponentChangedViews(nullptr, componentType);
+
+		uiw firstTask = tasksCount;
+		_componentChangedApplyTaskIndexes.clear();
+		for (uiw index = 0, size = stream->entityIds.size(); index < size; ++index)
+		{
+			EntityID entityID = stream->entityIds[index];
+			ASSUME(entityID);
+			const auto &entityLocation = _entitiesLocations[entityID.Hint()];
+			ASSUME(entityLocation.group->entities[entityLocation.index] == entityID);
+
+			auto [it, isInserted] = _componentChangedApplyTaskIndexes.emplace(entityLocation.group, static_cast<ui32>(tasksCount));
+			if (isInserted)
+			{
+				if (tasksCount == _componentChangedApplyTasks.size())
+				{
+					_componentChangedApplyTasks.emplace_back();
+				}
+				auto &task = _componentChangedApplyTasks[tasksCount++];
+				task.desc = &desc;
+				task.stream = stream.get();
+				task.group = entityLocation.group;
+				task.writeVersion = _writeVersion;
+				task.entries.clear();
+			}
+			_componentChangedApplyTasks[it->second].entries.emplace_back(static_cast<ui32>(index), entityLocation.index);
+		}
+
+		if (!isPartitioning)
+		{
+			continue;
+		}
+
+		// every group gets its own stream with the entries sorted by their row
+		for (uiw taskIndex = firstTask; taskIndex < tasksCount; ++taskIndex)
+		{
+			auto &task = _componentChangedApplyTasks[taskIndex];
+			SortByRow(task.entries, _componentChangedSortScratch);
+
+			auto partition = make_shared<MessageStreamComponentChanged::InfoWithData>();
+			partition->entityIds.reserve(task.entries.size());
+			if (!desc.isUnique)
+			{
+				partition->componentIds.reserve(task.entries.size());
+			}
+			partition->dataReserved = static_cast<ui32>(task.entries.size() * desc.sizeOf);
+			partition->data.reset(Allocator::MallocAlignedRuntime::Allocate(partition->dataReserved, desc.alignmentOf));
+
+			for (uiw index = 0; index < task.entries.size(); ++index)
+			{
+				ui32 &sourceIndex = task.entries[index].first;
+				partition->entityIds.push_back(stream->entityIds[sourceIndex]);
+				if (!desc.isUnique)
+				{
+					partition->componentIds.push_back(stream->componentIds[sourceIndex]);
+				}
+				MemOps::Copy(partition->data.get() + index * desc.sizeOf, stream->data.get() + sourceIndex * desc.sizeOf, desc.sizeOf);
+				sourceIndex = static_cast<ui32>(index);
+			}
+
+			task.stream = partition.get();
+			_partitionedComponentChanged.push_back({task.group->archetype.ToShort(), desc, move(partition)});
+		}
+	}
+
+	return tasksCount;
+}
+
+void SystemsManagerST::ApplyComponentChangedTask(const ComponentChangedApplyTask &task)
+{
+	const ComponentDescription &desc = *task.desc;
+	ASSUME(!desc.isTag); // tag components cannot be changed
+
+	uiw componentIndex = 0;
+	for (; ; ++componentIndex)
+	{
+		ASSUME(componentIndex < task.group->uniqueTypedComponentsCount);
+		if (task.group->components[componentIndex].type == desc.type)
+		{
+			break;
+		}
+	}
+
+	auto &componentArray = task.group->components[componentIndex];
+	componentArray.writtenAt = task.writeVersion;
+
+	ASSUME(desc.alignmentOf == componentArray.alignmentOf);
+	ASSUME(desc.isUnique == componentArray.isUnique);
+	ASSUME(desc.sizeOf == componentArray.sizeOf);
+
+	uiw rowSize = componentArray.sizeOf * componentArray.stride;
+	static constexpr uiw prefetchDistance = 8;
+
+	for (uiw entry = 0, size = task.entries.size(); entry < size; ++entry)
+	{
+		auto [index, entityIndex] = task.entries[entry];
+
+		if (entry + prefetchDistance < size)
+		{
+			Prefetch(componentArray.data.get() + rowSize * task.entries[entry + prefetchDistance].second);
+		}
+
+		uiw offset = 0;
+		if (!desc.isUnique)
+		{
+			for (; ; ++offset)
+			{
+				ASSUME(offset < componentArray.stride);
+				if (task.stream->componentIds[index] == componentArray.ids[entityIndex * componentArray.stride + offset])
+				{
+					break;
+				}
+			}
+		}
+
+		MemOps::Copy(componentArray.data.get() + rowSize * entityIndex + componentArray.sizeOf * offset, task.stream->data.get() + index * desc.sizeOf, desc.sizeOf);
+	}
+}
+
+void SystemsManagerST::ApplyComponentChangedTasks(uiw tasksCount, bool isParallel)
+{
+	if (!isParallel)
+	{
+		for (uiw index = 0; index < tasksCount; ++index)
+		{
+			ApplyComponentChangedTask(_componentChangedApplyTasks[index]);
+		}
+		return;
+	}
+
+	std::atomic<uiw> nextTask{0};
+	auto work = [this, &nextTask, tasksCount]
+	{
+		for (uiw index = nextTask++; index < tasksCount; index = nextTask++)
+		{
+			ApplyComponentChangedTask(_componentChangedApplyTasks[index]);
+		}
+	};
+
+	for (auto &worker : _workers)
+	{
+		worker.AddWork(work);
+	}
+	work(); // the scheduler thread takes part as well
 
-    controlsQueue.clear();
+	std::unique_lock lock{_workersDoneNotifier->first};
+	_workersDoneNotifier->second.wait(lock, [this] { return std::all_of(_workers.begin(), _workers.end(), [](const WorkerThread &worker) { return worker.WorkInProgressCount() == 0; }); });
+}
+
+void SystemsManagerST::SortArchetypeGroups()
+{
+	if (_sortKeys.empty())
+	{
+		return;
+	}
+
+	const auto &groups = _archetypeGroupsFull.Groups();
+	uiw visitedEntities = 0;
+	for (uiw visitedGroups = 0; visitedGroups < groups.size() && visitedEntities < sortedEntitiesPerFrame; ++visitedGroups)
+	{
+		if (_sortCursor >= groups.size())
+		{
+			_sortCursor = 0;
+		}
+		ArchetypeGroup &group = *groups[_sortCursor++];
+
+		// the first component with a sort key defines the order
+		for (uiw componentIndex = 0; componentIndex < group.uniqueTypedComponentsCount; ++componentIndex)
+		{
+			const auto &arr = group.components[componentIndex];
+			if (auto it = _sortKeys.find(arr.type); it != _sortKeys.end())
+			{
+				SortArchetypeGroup(group, arr, it->second);
+				visitedEntities += group.entitiesCount;
+				break;
+			}
+		}
+	}
 }
 
-void SystemsManagerST::PatchComponentAddedMessages(MessageBuilder &messageBuilder)
+void SystemsManagerST::SortArchetypeGroup(ArchetypeGroup &group, const ArchetypeGroup::ComponentArray &keyArray, const SortKeyFunction &keyFunction)
 {
-    for (auto &[componentType, stream] : messageBuilder.ComponentAddedStreams()._data)
-    {
-        for (auto &info : *stream)
-        {
-			const auto &[group, entityLocationIndex] = _entitiesLocations[info.entityID.Hint()];
-			ASSUME(group->entities[entityLocationIndex] == info.entityID);
+	_sortOrder.resize(group.entitiesCount);
+	for (ui32 index = 0; index < group.entitiesCount; ++index)
+	{
+		_sortOrder[index] = {keyFunction(keyArray.data.get() + keyArray.sizeOf * index * keyArray.stride), index};
+	}
 
-            for (ui32 index = 0; index < group->uniqueTypedComponentsCount; ++index)
-            {
-                const auto &stored = group->components[index];
+	auto byKey = [](const pair<ui64, ui32> &left, const pair<ui64, ui32> &right) { return left.first < right.first; };
+	if (std::is_sorted(_sortOrder.begin(), _sortOrder.end(), byKey))
+	{
+		return;
+	}
+	// the index is a tiebreaker, this way the entities with equal keys don't get moved
+	std::sort(_sortOrder.begin(), _sortOrder.end());
 
-                SerializedComponent serialized;
-                serialized.alignmentOf = stored.alignmentOf;
-                serialized.isTag = false;
-                serialized.isUnique = stored.isUnique;
-                serialized.sizeOf = stored.sizeOf;
-                serialized.type = stored.type;
-                
-                for (ui32 stride = 0; stride < stored.stride; ++stride)
-                {
-                    serialized.data = stored.data.get() + stored.sizeOf * entityLocationIndex * stored.stride + stride * stored.sizeOf;
-                    if (!serialized.isUnique)
-                    {
-                        serialized.id = stored.ids[entityLocationIndex * stored.stride + stride];
-                    }
+	DetachComponentChangedViews(&group, {});
 
-                    info.cab.AddComponent(serialized);
-                }
-            }
+	auto reorder = [this, &group](byte *data, uiw rowSize)
+	{
+		_sortScratch.resize(rowSize * group.entitiesCount);
+		for (ui32 index = 0; index < group.entitiesCount; ++index)
+		{
+			MemOps::Copy(_sortScratch.data() + rowSize * index, data + rowSize * _sortOrder[index].second, rowSize);
+		}
+		MemOps::Copy(data, _sortScratch.data(), _sortScratch.size());
+	};
 
-            info.componentsData = move(info.cab._data);
-            info.components = move(info.cab._components);
-            info.added = info.components.front();
-        }
-    }
-}
+	for (uiw componentIndex = 0; componentIndex < group.uniqueTypedComponentsCount; ++componentIndex)
+	{
+		auto &arr = group.components[componentIndex];
+		reorder(arr.data.get(), arr.sizeOf * arr.stride);
+		if (!arr.isUnique)
+		{
+			reorder(reinterpret_cast<byte *>(arr.ids.get()), sizeof(ComponentID) * arr.stride);
+		}
+	}
+	reorder(reinterpret_cast<byte *>(group.entities.get()), sizeof(EntityID));
 
-void SystemsManagerST::PatchEntityRemovedArchetypes(MessageBuilder &messageBuilder)
-{
-    for (EntityID id : messageBuilder.EntityRemovedNoArchetype())
-    {
-		const auto &entityLocation = _entitiesLocations[id.Hint()];
-		ASSUME(entityLocation.group->entities[entityLocation.index] == id);
-        messageBuilder.RemoveEntity(id, entityLocation.group->archetype.ToShort());
-    }
+	for (ui32 index = 0; index < group.entitiesCount; ++index)
+	{
+		_entitiesLocations[group.entities[index].Hint()].index = index;
+	}
 }
 
 void SystemsManagerST::UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(MessageBuilder &messageBuilder)
 {
     auto removeEntity = [this](ArchetypeGroup &group, ui32 index, ui32 entityLocationIndex)
     {
+        DetachComponentChangedViews(&group, {});
+
         --group.entitiesCount;
+        MarkArchetypeGroupWritten(group);
         uiw replaceIndex = group.entitiesCount;
 
         bool isReplaceWithLast = replaceIndex != index;
@@ -1402,16 +2394,11 @@ void SystemsManagerST::UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(M
 
         ArchetypeGroup *newGroup;
         ArchetypeFull archetype = ComputeArchetype(ToArray(_tempComponents));
-        auto groupSearch = _archetypeGroupsFull.find(archetype);
-        if (groupSearch == _archetypeGroupsFull.end())
+        newGroup = _archetypeGroupsFull.Find(archetype, ToArray(_tempComponents));
+        if (newGroup == nullptr)
         {
             newGroup = &AddNewArchetypeGroup(archetype, ToArray(_tempComponents));
         }
-        else
-        {
-            ASSUME(&groupSearch->second != group);
-            newGroup = &groupSearch->second;
-        }
 
 		#ifdef DEBUG
 			for (auto index = 0; index < newGroup->uniqueTypedComponentsCount; ++index)
@@ -1454,25 +2441,26 @@ void SystemsManagerST::UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(M
 
             ArchetypeFull archetype = ComputeArchetype(ToArray(entity.components));
 
-            ArchetypeGroup *group;
-            auto groupSearch = _archetypeGroupsFull.find(archetype);
-            if (groupSearch == _archetypeGroupsFull.end())
-            {
-                group = &AddNewArchetypeGroup(archetype, ToArray(entity.components));
-            }
-            else
-            {
-                group = &groupSearch->second;
-            }
+            ArchetypeGroup &group = FindArchetypeGroup(archetype, ToArray(entity.components));
 
-            AddEntityToArchetypeGroup(archetype, *group, entity.entityID, ToArray(entity.components), nullptr);
+            AddEntityToArchetypeGroup(archetype, group, entity.entityID, ToArray(entity.components), nullptr);
         }
     }
 
+    for (const auto &batch : messageBuilder._entitiesBatches)
+    {
+        AddEntitiesBatchToArchetypeGroup(FindArchetypeGroup(batch.archetypeFull, ToArray(batch.columns)), batch);
+    }
+
 	// these two must be below EntityAddedStreams in case the messages reference just added entities
 	PatchComponentAddedMessages(messageBuilder);
 	PatchEntityRemovedArchetypes(messageBuilder);
 
+    if (_isCoalescingMessages)
+    {
+        messageBuilder.Coalesce();
+    }
+
     for (auto &[componentType, stream] : messageBuilder.ComponentAddedStreams()._data)
     {
         for (const auto &info : *stream)
@@ -1481,73 +2469,100 @@ void SystemsManagerST::UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(M
         }
     }
 
-    for (const auto &[componentType, descWithStream] : messageBuilder.ComponentChangedStreams()._data)
-    {
-		const auto &[desc, stream] = descWithStream;
-
-		ArchetypeGroup *prevGroup = nullptr;
-		if (_archetypeGroups.size() && _archetypeGroups.begin()->second.size())
+	uiw changedCount = 0;
+	for (const auto &[componentType, descWithStream] : messageBuilder.ComponentChangedStreams()._data)
+	{
+		if (descWithStream.second->IsView() == false)
 		{
-			// the only case when there're no groups is when there're no entities,
-			// in that case any component changed message is an error
-			prevGroup = &_archetypeGroups.begin()->second.data()->get();
+			changedCount += descWithStream.second->entityIds.size();
 		}
-		uiw prevEntityIndex = uiw_max;
+	}
 
-		for (uiw index = 0, size = stream->entityIds.size(); index < size; ++index)
+	bool isParallel = _workers.size() && changedCount >= _parallelComponentChangedThreshold.load();
+	_isComponentChangedPartitioned = _isPartitioningComponentChanged;
+	if (isParallel || _isComponentChangedPartitioned)
+	{
+		uiw tasksCount = PrepareComponentChangedApplyTasks(messageBuilder, _isComponentChangedPartitioned);
+		ApplyComponentChangedTasks(tasksCount, isParallel);
+	}
+	else
+	{
+        for (const auto &[componentType, descWithStream] : messageBuilder.ComponentChangedStreams()._data)
         {
-			EntityID entityID = stream->entityIds[index];
+			const auto &[desc, stream] = descWithStream;
 
-            ASSUME(!desc.isTag); // tag components cannot be changed
-			ASSUME(entityID);
+			if (stream->IsView())
+			{
+				continue; // already in place
+			}
 
-			ArchetypeGroup *group = prevGroup;
-			uiw entityIndex = prevEntityIndex + 1;
+			DetachComponentChangedViews(nullptr, componentType);
 
-			if (entityID != prevGroup->entities[entityIndex])
+			ArchetypeGroup *prevGroup = nullptr;
+			if (_archetypeGroups.size() && _archetypeGroups.begin()->second.size())
 			{
-				auto &entityLocation = _entitiesLocations[entityID.Hint()];
-				group = entityLocation.group;
-				entityIndex = entityLocation.index;
-				ASSUME(group->entities[entityIndex] == entityID);
+				// the only case when there're no groups is when there're no entities,
+				// in that case any component changed message is an error
+				prevGroup = &_archetypeGroups.begin()->second.data()->get();
 			}
+			uiw prevEntityIndex = uiw_max;
 
-            uiw componentIndex = 0;
-            for (; ; ++componentIndex)
+			for (uiw index = 0, size = stream->entityIds.size(); index < size; ++index)
             {
-                ASSUME(componentIndex < group->uniqueTypedComponentsCount);
-                if (group->components[componentIndex].type == componentType)
+				EntityID entityID = stream->entityIds[index];
+
+                ASSUME(!desc.isTag); // tag components cannot be changed
+				ASSUME(entityID);
+
+				ArchetypeGroup *group = prevGroup;
+				uiw entityIndex = prevEntityIndex + 1;
+
+				if (prevGroup == nullptr || entityID != prevGroup->entities[entityIndex])
+				{
+					auto &entityLocation = _entitiesLocations[entityID.Hint()];
+					group = entityLocation.group;
+					entityIndex = entityLocation.index;
+					ASSUME(group->entities[entityIndex] == entityID);
+				}
+
+                uiw componentIndex = 0;
+                for (; ; ++componentIndex)
                 {
-                    break;
+                    ASSUME(componentIndex < group->uniqueTypedComponentsCount);
+                    if (group->components[componentIndex].type == componentType)
+                    {
+                        break;
+                    }
                 }
-            }
 
-            auto &componentArray = group->components[componentIndex];
+                auto &componentArray = group->components[componentIndex];
+				componentArray.writtenAt = _writeVersion;
 
-            ASSUME(desc.alignmentOf == componentArray.alignmentOf);
-            ASSUME(desc.isUnique == componentArray.isUnique);
-            ASSUME(desc.sizeOf == componentArray.sizeOf);
-            ASSUME(desc.type == componentArray.type);
+                ASSUME(desc.alignmentOf == componentArray.alignmentOf);
+                ASSUME(desc.isUnique == componentArray.isUnique);
+                ASSUME(desc.sizeOf == componentArray.sizeOf);
+                ASSUME(desc.type == componentArray.type);
 
-            uiw offset = 0;
-            if (!desc.isUnique)
-            {
-                for (; ; ++offset)
+                uiw offset = 0;
+                if (!desc.isUnique)
                 {
-                    ASSUME(offset < componentArray.stride);
-                    if (stream->componentIds[index] == componentArray.ids[entityIndex * componentArray.stride + offset])
+                    for (; ; ++offset)
                     {
-                        break;
+                        ASSUME(offset < componentArray.stride);
+                        if (stream->componentIds[index] == componentArray.ids[entityIndex * componentArray.stride + offset])
+                        {
+                            break;
+                        }
                     }
                 }
-            }
 
-            MemOps::Copy(componentArray.data.get() + componentArray.sizeOf * componentArray.stride * entityIndex + componentArray.sizeOf * offset, stream->data.get() + index * desc.sizeOf, desc.sizeOf);
+                MemOps::Copy(componentArray.data.get() + componentArray.sizeOf * componentArray.stride * entityIndex + componentArray.sizeOf * offset, stream->data.get() + index * desc.sizeOf, desc.sizeOf);
 
-			prevGroup = group;
-			prevEntityIndex = entityIndex;
+				prevGroup = group;
+				prevEntityIndex = entityIndex;
+            }
         }
-    }
+	}
 
     for (const auto &[componentType, stream] : messageBuilder.ComponentRemovedStreams()._data)
     {
@@ -1571,26 +2586,38 @@ void SystemsManagerST::UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(M
             removeEntity(*entityLocation.group, entityLocation.index, entityId.Hint());
         }
     }
+    ApplyMatchingCommands(messageBuilder); // must be the last one, it adds the messages about the processed groups
 }
 
 void SystemsManagerST::PassMessagesToIndirectSystemsAndClear(MessageBuilder &messageBuilder, System *systemToIgnore)
 {
     for (auto &[streamArchetype, streamPointer] : messageBuilder.EntityAddedStreams()._data)
     {
-        auto reflected = _archetypeReflector.Reflect(streamArchetype);
         auto stream = MessageStreamRegisterEntity(streamArchetype, streamPointer, messageBuilder.SourceName());
 
-        for (auto &pipeline : _pipelines)
+        for (auto *managed : ArchetypeRoutes(streamArchetype))
+        {
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::RegisterEntity))
+            {
+                managed->messageQueue.registerEntityStreams.emplace_back(stream);
+            }
+        }
+    }
+
+    // the batches are converted into streams only if somebody is going to receive them
+    for (const auto &batch : messageBuilder._entitiesBatches)
+    {
+        optional<MessageStreamRegisterEntity> stream;
+
+        for (auto *managed : ArchetypeRoutes(batch.archetype))
         {
-            for (auto &managed : pipeline.indirectSystems)
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::RegisterEntity))
             {
-                if (managed.system.get() != systemToIgnore)
+                if (!stream)
                 {
-                    if (ArchetypeReflector::Satisfies(reflected, managed.system->RequestedComponents().archetypeDefiningInfoOnly))
-                    {
-                        managed.messageQueue.registerEntityStreams.emplace_back(stream);
-                    }
+                    stream = MessageStreamRegisterEntity(batch.archetype, messageBuilder.EntitiesBatchToStream(batch), messageBuilder.SourceName());
                 }
+                managed->messageQueue.registerEntityStreams.emplace_back(*stream);
             }
         }
     }
@@ -1599,102 +2626,83 @@ void SystemsManagerST::PassMessagesToIndirectSystemsAndClear(MessageBuilder &mes
     {
 		auto stream = MessageStreamComponentAdded(componentType, {}, streamPointer, messageBuilder.SourceName());
 
-        for (auto &pipeline : _pipelines)
+        for (auto *managed : ComponentRoutes(componentType))
         {
-            for (auto &managed : pipeline.indirectSystems)
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::ComponentAdded))
             {
-                if (managed.system.get() != systemToIgnore)
-                {
-                    auto requested = managed.system->RequestedComponents();
-                    auto searchPredicate = [componentType = componentType](const System::ComponentRequest &stored) { return componentType == stored.type; };
-
-                    if (requested.subtractive.find_if(searchPredicate) != requested.subtractive.end())
-                    {
-                        continue;
-                    }
-
-                    if (requested.required.empty() ||
-                        requested.requiredOrOptional.count_if(searchPredicate))
-                    {
-                        managed.messageQueue.componentAddedStreams.emplace_back(stream);
-                    }
-                }
+                managed->messageQueue.componentAddedStreams.emplace_back(stream);
             }
         }
     }
 
-    for (const auto &[componentType, streamPointer] : messageBuilder.ComponentChangedStreams()._data)
+    auto passComponentChanged = [this, systemToIgnore](const MessageStreamComponentChanged &stream)
     {
-		auto stream = MessageStreamComponentChanged({}, streamPointer.second, streamPointer.first, messageBuilder.SourceName());
-
-        for (auto &pipeline : _pipelines)
+        for (auto *managed : ComponentRoutes(stream.Type()))
         {
-            for (auto &managed : pipeline.indirectSystems)
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::ComponentChanged))
             {
-                if (managed.system.get() != systemToIgnore)
+                if (managed->system->ComponentChangedMessagesPolicy() == BaseIndirectSystem::ComponentChangedPolicy::LatestState)
                 {
-                    auto requested = managed.system->RequestedComponents();
-                    auto searchPredicate = [componentType = componentType](const System::ComponentRequest &stored) { return componentType == stored.type; };
-
-                    if (requested.subtractive.find_if(searchPredicate) != requested.subtractive.end())
-                    {
-                        continue;
-                    }
-
-                    if (requested.required.empty() ||
-                        requested.requiredOrOptional.count_if(searchPredicate))
-                    {
-                        managed.messageQueue.componentChangedStreams.emplace_back(stream);
-                    }
+                    managed->messageQueue.AddLatestComponentChanged(stream);
+                }
+                else
+                {
+                    managed->messageQueue.componentChangedStreams.emplace_back(stream);
                 }
             }
         }
+    };
+
+    for (const auto &[componentType, streamPointer] : messageBuilder.ComponentChangedStreams()._data)
+    {
+		Archetype streamArchetype{};
+		if (_isComponentChangedPartitioned)
+		{
+			if (streamPointer.second->IsView() == false)
+			{
+				continue; // replaced by _partitionedComponentChanged
+			}
+
+			// views always reference a single group
+			auto view = _componentChangedViews.find(streamPointer.second.get());
+			if (view != _componentChangedViews.end())
+			{
+				streamArchetype = view->second.group->archetype.ToShort();
+			}
+		}
+
+		passComponentChanged(MessageStreamComponentChanged(streamArchetype, streamPointer.second, streamPointer.first, messageBuilder.SourceName()));
+    }
+
+    for (const auto &partitioned : _partitionedComponentChanged)
+    {
+		passComponentChanged(MessageStreamComponentChanged(partitioned.archetype, partitioned.info, partitioned.desc, messageBuilder.SourceName()));
     }
+    _partitionedComponentChanged.clear();
+    _isComponentChangedPartitioned = false;
 
     for (const auto &[componentType, streamPointer] : messageBuilder.ComponentRemovedStreams()._data)
     {
 		auto stream = MessageStreamComponentRemoved(componentType, {}, streamPointer, messageBuilder.SourceName());
 
-        for (auto &pipeline : _pipelines)
+        for (auto *managed : ComponentRoutes(componentType))
         {
-            for (auto &managed : pipeline.indirectSystems)
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::ComponentRemoved))
             {
-                if (managed.system.get() != systemToIgnore)
-                {
-                    auto requested = managed.system->RequestedComponents();
-                    auto searchPredicate = [componentType = componentType](const System::ComponentRequest &stored) { return componentType == stored.type; };
-
-                    if (requested.subtractive.find_if(searchPredicate) != requested.subtractive.end())
-                    {
-                        continue;
-                    }
-
-                    if (requested.required.empty() ||
-                        requested.requiredOrOptional.count_if(searchPredicate))
-                    {
-                        managed.messageQueue.componentRemovedStreams.emplace_back(stream);
-                    }
-                }
+                managed->messageQueue.componentRemovedStreams.emplace_back(stream);
             }
         }
     }
 
     for (const auto &[streamArchetype, streamPointer] : messageBuilder.EntityRemovedStreams()._data)
     {
-        auto reflected = _archetypeReflector.Reflect(streamArchetype);
         auto stream = MessageStreamUnregisterEntity(streamArchetype, streamPointer, messageBuilder.SourceName());
 
-        for (auto &pipeline : _pipelines)
+        for (auto *managed : ArchetypeRoutes(streamArchetype))
         {
-            for (auto &managed : pipeline.indirectSystems)
+            if (managed->system.get() != systemToIgnore && managed->acceptedMessageTypes.Contains(MessageTypes::UnregisterEntity))
             {
-                if (managed.system.get() != systemToIgnore)
-                {
-                    if (ArchetypeReflector::Satisfies(reflected, managed.system->RequestedComponents().archetypeDefiningInfoOnly))
-                    {
-                        managed.messageQueue.unregisterEntityStreams.emplace_back(stream);
-                    }
-                }
+                managed->messageQueue.unregisterEntityStreams.emplace_back(stream);
             }
         }
     }
@@ -1702,10 +2710,41 @@ void SystemsManagerST::PassMessagesToIndirectSystemsAndClear(MessageBuilder &mes
     messageBuilder.Clear();
 }
 
-bool SystemsManagerST::SendControlActionToQueue(ControlsQueue &controlsQueue, const ControlAction &action)
+void SystemsManagerST::ManagedIndirectSystem::MessageQueue::AddLatestComponentChanged(const MessageStreamComponentChanged &stream)
 {
-    controlsQueue.push_back(action);
-    return false;
+    const ComponentDescription &desc = stream.ComponentDesc();
+
+    auto latest = std::find_if(latestComponentChanged.begin(), latestComponentChanged.end(), [&desc](const LatestComponentChanged &stored) { return stored.desc.type == desc.type; });
+    if (latest == latestComponentChanged.end())
+    {
+        LatestComponentChanged added;
+        added.desc = desc;
+        added.info = make_shared<MessageStreamComponentChanged::InfoWithData>();
+        latestComponentChanged.push_back(move(added));
+        latest = latestComponentChanged.end() - 1;
+    }
+
+    const auto &source = *stream._source;
+    auto entityIds = source.EntityIds();
+    const byte *data = source.Data(); // the values are copied, so views don't need to be detached
+    auto &info = *latest->info;
+
+    for (uiw index = 0; index < entityIds.size(); ++index)
+    {
+        ComponentID componentID = source.componentIds.size() ? source.componentIds[index] : ComponentID{};
+        ui64 key = (static_cast<ui64>(entityIds[index].Hash()) << 32) | componentID.Hash();
+        const byte *componentData = data + index * desc.sizeOf;
+
+        auto [it, isInserted] = latest->indexes.emplace(key, static_cast<ui32>(info.entityIds.size()));
+        if (isInserted)
+        {
+            info.Append(entityIds[index], componentData, componentID, desc.sizeOf, desc.alignmentOf);
+        }
+        else
+        {
+            MemOps::Copy(info.data.get() + it->second * desc.sizeOf, componentData, desc.sizeOf);
+        }
+    }
 }
 
 void SystemsManagerST::ManagedIndirectSystem::MessageQueue::clear()
@@ -1715,6 +2754,19 @@ void SystemsManagerST::ManagedIndirectSystem::MessageQueue::clear()
     componentChangedStreams.clear();
     componentRemovedStreams.clear();
     unregisterEntityStreams.clear();
+
+    for (auto &latest : latestComponentChanged)
+    {
+        if (latest.info.use_count() == 1)
+        {
+            latest.info->Reset();
+        }
+        else
+        {
+            latest.info = make_shared<MessageStreamComponentChanged::InfoWithData>(); // the system kept the stream
+        }
+        latest.indexes.clear();
+    }
 }
 
 bool SystemsManagerST::ManagedIndirectSystem::MessageQueue::empty() const
@@ -1723,6 +2775,135 @@ bool SystemsManagerST::ManagedIndirectSystem::MessageQueue::empty() const
         registerEntityStreams.empty() &&
         componentAddedStreams.empty() &&
         componentChangedStreams.empty() &&
+        std::all_of(latestComponentChanged.begin(), latestComponentChanged.end(), [](const LatestComponentChanged &latest) { return latest.info->entityIds.empty(); }) &&
         componentRemovedStreams.empty() &&
         unregisterEntityStreams.empty();
-}
\ No newline at end of file
+}
+
+bool SystemsManagerST::ArchetypeGroup::IsMatching(Array<const SerializedComponent> components) const
+{
+	if (components.size() != key.size())
+	{
+		return false;
+	}
+
+	// the components can't repeat, so finding each of them is enough
+	for (const auto &component : components)
+	{
+		if (!std::binary_search(key.begin(), key.end(), pair{component.type, component.id}))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SystemsManagerST::ArchetypeGroup::AssignKey(Array<const SerializedComponent> components)
+{
+	key.clear();
+	for (const auto &component : components)
+	{
+		key.emplace_back(component.type, component.id);
+	}
+	std::sort(key.begin(), key.end());
+}
+
+void SystemsManagerST::ArchetypeGroupsTable::InsertSlot(ui64 hash, ArchetypeGroup *group)
+{
+	// keep the load factor at most 1/2
+	if (_pool.size() * 2 > _slots.size())
+	{
+		vector<Slot> previous = move(_slots);
+		_slots = vector<Slot>(std::max<uiw>(previous.size() * 2, 16));
+		for (const Slot &slot : previous)
+		{
+			if (slot.group)
+			{
+				uiw index = slot.hash & (_slots.size() - 1);
+				while (_slots[index].group)
+				{
+					index = (index + 1) & (_slots.size() - 1);
+				}
+				_slots[index] = slot;
+			}
+		}
+	}
+
+	uiw index = hash & (_slots.size() - 1);
+	while (_slots[index].group)
+	{
+		index = (index + 1) & (_slots.size() - 1);
+	}
+	_slots[index] = {hash, group};
+}
+
+void SystemsManagerST::ArchetypeGroupsTable::EraseSlot(uiw index)
+{
+	// backward shift deletion, so the probe sequences don't need tombstones
+	uiw mask = _slots.size() - 1;
+	for (uiw next = (index + 1) & mask; _slots[next].group; next = (next + 1) & mask)
+	{
+		uiw desired = _slots[next].hash & mask;
+		if (((next - desired) & mask) >= ((next - index) & mask))
+		{
+			_slots[index] = _slots[next];
+			index = next;
+		}
+	}
+	_slots[index] = {};
+}
+
+auto SystemsManagerST::ArchetypeGroupsTable::Find(const ArchetypeFull &archetype, Array<const SerializedComponent> components) const -> ArchetypeGroup *
+{
+	if (_slots.empty())
+	{
+		return nullptr;
+	}
+
+	ui64 hash = archetype.Hash();
+	uiw mask = _slots.size() - 1;
+	for (uiw index = hash & mask; _slots[index].group; index = (index + 1) & mask)
+	{
+		if (_slots[index].hash == hash && _slots[index].group->IsMatching(components))
+		{
+			return _slots[index].group;
+		}
+	}
+
+	return nullptr;
+}
+
+auto SystemsManagerST::ArchetypeGroupsTable::Insert(const ArchetypeFull &archetype, Array<const SerializedComponent> components) -> ArchetypeGroup &
+{
+	ASSUME(Find(archetype, components) == nullptr);
+
+	auto &group = *_pool.emplace_back(make_unique<ArchetypeGroup>());
+	group.archetype = archetype;
+	group.AssignKey(components);
+	InsertSlot(archetype.Hash(), &group);
+	return group;
+}
+
+void SystemsManagerST::ArchetypeGroupsTable::Rekey(ArchetypeGroup &group, const ArchetypeFull &archetype, Array<const SerializedComponent> components)
+{
+	ASSUME(Find(archetype, components) == nullptr);
+
+	uiw mask = _slots.size() - 1;
+	uiw index = group.archetype.Hash() & mask;
+	while (_slots[index].group != &group)
+	{
+		ASSUME(_slots[index].group);
+		index = (index + 1) & mask;
+	}
+	EraseSlot(index);
+
+	group.archetype = archetype;
+	group.AssignKey(components);
+	InsertSlot(archetype.Hash(), &group);
+}
+
+auto SystemsManagerST::ArchetypeGroupsTable::Groups() const -> const vector<unique_ptr<ArchetypeGroup>> &
+{
+	return _pool;
+}
@@ -3,12 +3,14 @@
 #include "SystemsManager.hpp"
 #include "MessageBuilder.hpp"
 #include "ArchetypeReflector.hpp"
+#include "DirectQuery.hpp"
 
 namespace ECSTest
 {
-	class SystemsManagerST : public SystemsManager, public std::enable_shared_from_this<SystemsManagerST>
+	class SystemsManagerST : public SystemsManager, public IDirectQuery, public IParallelFor, public std::enable_shared_from_this<SystemsManagerST>
 	{
 		friend class ECSEntitiesST;
+		friend UnitTests;
 
 	protected:
 		~SystemsManagerST() = default;
@@ -21,6 +23,11 @@ namespace ECSTest
         [[nodiscard]] virtual PipelineInfo GetPipelineInfo(Pipeline pipeline) const override;
         [[nodiscard]] virtual ManagerInfo GetManagerInfo() const override;
         virtual void SetLogger(const shared_ptr<LoggerType> &logger) override;
+        virtual void SetMessageCoalescing(bool isEnabled) override;
+        virtual void SetComponentChangedPartitioning(bool isEnabled) override;
+        virtual void SetParallelComponentChangedThreshold(uiw threshold) override;
+        virtual void SetSortKeyUntyped(TypeId componentType, SortKeyFunction keyFunction) override;
+        virtual void SetInputRing(const shared_ptr<ControlsRing> &ring) override;
         virtual void Register(unique_ptr<System> system, Pipeline pipeline) override;
 		virtual void Unregister(TypeId systemType) override;
 		virtual void Start(AssetsManager &&assetsManager, EntityIDGenerator &&idGenerator, vector<WorkerThread> &&workers, vector<unique_ptr<IEntitiesStream>> &&streams) override;
@@ -31,6 +38,8 @@ namespace ECSTest
 		[[nodiscard]] virtual bool IsPaused() const override;
 		//virtual void StreamIn(vector<unique_ptr<IEntitiesStream>> &&streams) override;
 		[[nodiscard]] virtual shared_ptr<IEntitiesStream> StreamOut() const override; // the manager must be paused
+		virtual void ForEachUntyped(const System::Requests &requests, IDirectQuery::Callback callback, void *context) override;
+		virtual void Execute(uiw count, uiw minimalChunk, IParallelFor::Callback callback, void *context) override;
 		
 	private:
 		struct ArchetypeGroup
@@ -44,6 +53,7 @@ namespace ECSTest
 				unique_ptr<byte[], AlignedMallocDeleter> data{}; // each component can be safely casted into class Component
 				unique_ptr<ComponentID[], MallocDeleter> ids{}; // ComponentID, used only for components that allow multiple components of that type to be attached to an entity
 				bool isUnique{}; // indicates whether other components of the same type can be attached to an entity
+				ui64 writtenAt{}; // _writeVersion of the last write into any entity's component of this type or of the last change of the group's entities, used by Changed filters and reactive systems
 			};
 
 			unique_ptr<ComponentArray[]> components{}; // essentially a 2D array where rows count = uniqueTypedComponentsCount, columns count is computed per row as entitiesCount * stride
@@ -54,6 +64,36 @@ namespace ECSTest
 			ui32 entitiesReservedCount{};
 			ui32 entitiesCount{};
 			ArchetypeFull archetype; // group's archetype
+			vector<pair<TypeId, ComponentID>> key{}; // sorted types and ComponentIDs of the archetype, compared on lookups so a hash collision can't mix up the groups
+			const ArchetypeReflector::StoredArchetype *reflected{}; // the library's entry of the group's sorted unique types
+
+			[[nodiscard]] bool IsMatching(Array<const SerializedComponent> components) const;
+			void AssignKey(Array<const SerializedComponent> components);
+		};
+
+		// open addressing hash table of the archetype groups with linear probing,
+		// the groups live in a pool, so their addresses are stable
+		class ArchetypeGroupsTable
+		{
+			friend UnitTests;
+
+			struct Slot
+			{
+				ui64 hash{};
+				ArchetypeGroup *group{}; // nullptr for the empty slots
+			};
+
+			vector<Slot> _slots{}; // the size is always a power of two
+			vector<unique_ptr<ArchetypeGroup>> _pool{};
+
+			void InsertSlot(ui64 hash, ArchetypeGroup *group);
+			void EraseSlot(uiw index);
+
+		public:
+			[[nodiscard]] ArchetypeGroup *Find(const ArchetypeFull &archetype, Array<const SerializedComponent> components) const;
+			[[nodiscard]] ArchetypeGroup &Insert(const ArchetypeFull &archetype, Array<const SerializedComponent> components); // such group must not exist yet
+			void Rekey(ArchetypeGroup &group, const ArchetypeFull &archetype, Array<const SerializedComponent> components); // the group's entities and components stay in place
+			[[nodiscard]] const vector<unique_ptr<ArchetypeGroup>> &Groups() const;
 		};
 
 		struct EntityLocation
@@ -66,17 +106,23 @@ namespace ECSTest
 		{
 			ui32 executedAt{}; // last executed frame, gets set to PipelineData::executionFrame at first execution attempt on a new frame
             ui32 executedTimes{};
-            ControlsQueue controlsReceivedQueue{}, controlsToSendQueue{}; // 2 separate queues are necessary because you can send new control actions from ControlInput method
+			bool isReactive = false; // see System::IsReactive
+			ui64 controlsCursor{}; // position within the controls log of the first control action the system hasn't received yet
 		};
 
 		struct ManagedDirectSystem : ManagedSystem
 		{
 			unique_ptr<BaseDirectSystem> system{};
+			IKeyController::ListenerHandle controlsListener{}; // registered on the first execution, declared after the system to be released before the system's key controller
+			ui64 changesSeenAt{}; // _writeVersion at the previous execution, the groups written after it pass the Changed filters
+			vector<TypeId> inputTypes{}; // withData types, a reactive system is executed only if one of them was written since changesSeenAt
 		};
 
 		struct ManagedIndirectSystem : ManagedSystem
 		{
 			unique_ptr<BaseIndirectSystem> system{};
+			IKeyController::ListenerHandle controlsListener{}; // registered on the first execution, declared after the system to be released before the system's key controller
+			MessageTypes::MessageType acceptedMessageTypes = MessageTypes::_All;
 			// contains messages that the system needs to process before it starts its update
 			struct MessageQueue
 			{
@@ -86,11 +132,48 @@ namespace ECSTest
                 vector<MessageStreamComponentRemoved> componentRemovedStreams{};
 				vector<MessageStreamUnregisterEntity> unregisterEntityStreams{};
 
+				// used instead of componentChangedStreams by the systems with ComponentChangedPolicy::LatestState,
+				// one entry per component type, its size is bounded by the number of components of that type
+				struct LatestComponentChanged
+				{
+					ComponentDescription desc{};
+					shared_ptr<MessageStreamComponentChanged::InfoWithData> info{};
+					std::unordered_map<ui64, ui32> indexes{}; // EntityID and ComponentID -> index within info
+				};
+				vector<LatestComponentChanged> latestComponentChanged{};
+
+				void AddLatestComponentChanged(const MessageStreamComponentChanged &stream);
 				void clear();
 				bool empty() const;
 			} messageQueue{};
 		};
 
+		// ComponentChanged streams that reference a group's column instead of owning a copy of the data,
+		// they must be detached before the column gets modified
+		struct ComponentChangedView
+		{
+			const ArchetypeGroup *group{};
+			ComponentDescription desc{};
+			std::weak_ptr<MessageStreamComponentChanged::InfoWithData> info{};
+		};
+
+		// ComponentChanged entries of a single stream that go to the same group, applied by a single thread
+		struct ComponentChangedApplyTask
+		{
+			const ComponentDescription *desc{};
+			const MessageStreamComponentChanged::InfoWithData *stream{};
+			ArchetypeGroup *group{};
+			ui64 writeVersion{};
+			vector<pair<ui32, ui32>> entries{}; // index within the stream, entity index within the group
+		};
+
+		// control actions sent by a system, every other system with a key controller receives them
+		struct ControlsLogEntry
+		{
+			ControlAction action{};
+			const System *sender{};
+		};
+
 		struct PipelineData
 		{
 			// every time the schedule sends a system to be executed by a worker, it increments this value
@@ -101,6 +184,7 @@ namespace ECSTest
 			vector<ManagedIndirectSystem> indirectSystems{};
 			optional<TimeDifference> executionStep{};
 			MovableAtomic<TimeDifference> timeSpentExecuting{};
+			MovableAtomic<ui32> skippedExecutions = 0;
             TimeMoment lastExecutedTime{};
 			vector<TypeId> writeComponents{}; // list of components requested for write by the systems of this pipeline
 		};
@@ -114,17 +198,35 @@ namespace ECSTest
 		vector<EntityLocation> _entitiesLocations{};
 
 		// stores all entities and their components grouped by archetype
-		std::unordered_map<ArchetypeFull, ArchetypeGroup> _archetypeGroupsFull{};
+		ArchetypeGroupsTable _archetypeGroupsFull{};
 		// similar archetypes, like the ones containing entities with multiple components of the same type,
 		// will be considered as same archetype, so if you don't care about the components count
-		// but only about their presence, use this
-		std::unordered_map<Archetype, vector<std::reference_wrapper<ArchetypeGroup>>> _archetypeGroups{};
+		// but only about their presence, use this, keyed by the reflector's entries of the sorted types,
+		// so the archetypes with colliding hashes don't share the groups
+		std::unordered_map<const ArchetypeReflector::StoredArchetype *, vector<std::reference_wrapper<ArchetypeGroup>>> _archetypeGroups{};
 
 		// stores Systems within their pipelines, used by the manager to iterate through the systems
 		vector<PipelineData> _pipelines{};
 
 		ArchetypeReflector _archetypeReflector{};
 
+		// keyed by the stream's info, an expired entry's address can be reused by a new view which then replaces it
+		std::unordered_map<const MessageStreamComponentChanged::InfoWithData *, ComponentChangedView> _componentChangedViews{};
+
+		// append-only log of the control actions sent by the systems, each system reads it through its own cursor instead of
+		// receiving a copy, the entries read by all the systems with key controllers are dropped at the end of the scheduler's loop
+		vector<ControlsLogEntry> _controlsLog{};
+		ui64 _controlsLogStart{}; // position of _controlsLog[0]
+		bool _isDispatchingControlsLog = false; // the actions from the log must not be written back into it
+		System *_executingSystem{}; // along with its environment used by the persistent control action listeners
+		System::Environment *_executingEnvironment{};
+		shared_ptr<ControlsRing> _inputRing{};
+
+		// indirect systems that receive the messages of a component type or an archetype, in the order of their execution,
+		// rebuilt when the systems are registered or unregistered, new archetypes are added along with their groups
+		std::unordered_map<TypeId, vector<ManagedIndirectSystem *>> _componentRoutes{};
+		std::unordered_map<Archetype, vector<ManagedIndirectSystem *>> _archetypeRoutes{};
+
 		std::atomic<bool> _isStoppingExecution{false};
 
 		std::atomic<bool> _isPausedExecution{false};
@@ -138,40 +240,102 @@ namespace ECSTest
 		EntityIDGenerator _entityIdGenerator{};
         ComponentIDGenerator _componentIdGenerator{};
 		UniqueIdManager _entityHintGenerator{};
+		ui64 _writeVersion{}; // incremented before each system's execution, the writes get stamped with it
 
         std::atomic<TimeDifference> _timeSinceStartAtomic{};
         TimeDifference _timeSinceStart{};
         TimeMoment _currentTime{};
 
         shared_ptr<LoggerType> _logger = make_shared<LoggerType>();
+        std::atomic<bool> _isCoalescingMessages{false};
+        std::atomic<bool> _isPartitioningComponentChanged{false};
+        std::atomic<uiw> _parallelComponentChangedThreshold{16384}; // fewer changes than that are applied by the scheduler thread alone
 
         vector<SerializedComponent> _tempComponents{};
-        vector<Array<byte>> _tempArrayArgs{};
-		vector<NonUnique<byte>> _tempNonUniqueArgs{};
-        vector<void *> _tempArgs{};
+		vector<ArchetypeGroup *> _tempDirectGroups{};
+		vector<BaseDirectSystem::GroupColumn> _tempGroupColumns{};
+		vector<BaseDirectSystem::GroupArguments> _tempGroupArguments{};
 
         MessageBuilder _tempMessageBuilder{};
+		vector<ArchetypeGroup *> _tempMatchingGroups{};
+		std::unordered_set<uiw> _trackedDirectQueries{}; // addresses of the queries' requests, they're used as ids for the archetype reflector
+
+		// arguments of the direct queries, the queries can be nested, so each depth gets its own set that is reused between the calls
+		struct DirectQueryArguments
+		{
+			vector<NonUnique<byte>> nonUniqueArgs{};
+			vector<Array<byte>> arrayArgs{};
+			vector<void *> args{};
+		};
+		vector<unique_ptr<DirectQueryArguments>> _directQueryArguments{}; // pointers stay valid when a nested query adds a depth
+		uiw _directQueryDepth = 0;
+
+		// used only to apply ComponentChanged messages, the systems are still executed by the scheduler thread
+		vector<WorkerThread> _workers{};
+		shared_ptr<pair<std::mutex, std::condition_variable>> _workersDoneNotifier = make_shared<pair<std::mutex, std::condition_variable>>();
+		vector<ComponentChangedApplyTask> _componentChangedApplyTasks{}; // kept between the frames to reuse the memory
+		std::unordered_map<ArchetypeGroup *, ui32> _componentChangedApplyTaskIndexes{};
+		vector<pair<ui32, ui32>> _componentChangedSortScratch{};
+
+		// owned ComponentChanged streams split by the archetype of their entities, replace the original streams when delivered
+		struct PartitionedComponentChanged
+		{
+			Archetype archetype{};
+			ComponentDescription desc{};
+			shared_ptr<MessageStreamComponentChanged::InfoWithData> info{};
+		};
+		vector<PartitionedComponentChanged> _partitionedComponentChanged{};
+		bool _isComponentChangedPartitioned = false; // set when the current messages were partitioned
+
+		std::unordered_map<TypeId, SortKeyFunction> _sortKeys{};
+		uiw _sortCursor{}; // index of the archetype group the sorting continues from on the next frame
+		vector<pair<ui64, ui32>> _sortOrder{}; // key and the entity's current index
+		vector<byte> _sortScratch{};
 
 		AssetsManager _assetsManager{};
+		SpatialHashGrid _spatialIndex{};
 
         static constexpr string_view selfName = "ECSSingleThreaded";
+		static constexpr uiw sortedEntitiesPerFrame = 16384; // the groups are checked until that many entities were visited, a group is never split between the frames
 
 	private:
 		[[nodiscard]] ArchetypeGroup &FindArchetypeGroup(const ArchetypeFull &archetype, Array<const SerializedComponent> components);
 		ArchetypeGroup &AddNewArchetypeGroup(const ArchetypeFull &archetype, Array<const SerializedComponent> components);
+		static void ReserveArchetypeGroupEntities(ArchetypeGroup &group, ui32 count); // grows the group's arrays to fit at least count entities
 		void AddEntityToArchetypeGroup(const ArchetypeFull &archetype, ArchetypeGroup &group, EntityID entityId, Array<const SerializedComponent> components, MessageBuilder *messageBuilder);
+		void AddEntitiesBatchToArchetypeGroup(ArchetypeGroup &group, const MessageBuilder::EntitiesBatch &batch);
+		void MoveArchetypeGroupEntities(ArchetypeGroup &source, ArchetypeGroup &target); // the groups must differ only by their tags
+		void DestroyArchetypeGroupEntities(ArchetypeGroup &group, MessageBuilder &messageBuilder);
+		void RetagArchetypeGroup(ArchetypeGroup &group, const ComponentDescription &tag, bool isAdding, MessageBuilder &messageBuilder);
+		void ApplyMatchingCommands(MessageBuilder &messageBuilder);
 		void StartScheduler(vector<unique_ptr<IEntitiesStream>> &streams);
 		void SchedulerLoop();
 		void ExecutePipeline(PipelineData &pipeline, TimeDifference timeSinceLastFrame);
 		static void ProcessMessagesAndClear(BaseIndirectSystem &system, ManagedIndirectSystem::MessageQueue &messageQueue, System::Environment &env);
-        void ExecuteIndirectSystem(BaseIndirectSystem &system, ManagedIndirectSystem::MessageQueue &messageQueue, ControlsQueue &controlsReceivedQueue, ControlsQueue &controlsToSendQueue, System::Environment &env);
-        void ExecuteDirectSystem(BaseDirectSystem &system, ControlsQueue &controlsReceivedQueue, ControlsQueue &controlsToSendQueue, System::Environment &env);
-        static void ProcessControlsQueueAndClear(System &system, ControlsQueue &controlsQueue);
-        void PassControlsToOtherSystemsAndClear(ControlsQueue &controlsQueue, System *systemToIgnore);
+        void ExecuteIndirectSystem(BaseIndirectSystem &system, ManagedIndirectSystem::MessageQueue &messageQueue, ui64 &controlsCursor, System::Environment &env);
+        static void FillArchetypeGroupArguments(const ArchetypeGroup &group, const System::Requests &requested, System::Environment *env, vector<NonUnique<byte>> &nonUniqueArgs, vector<Array<byte>> &arrayArgs, vector<void *> &args); // the vectors must have enough capacity to not reallocate
+        static void FillArchetypeGroupColumns(const ArchetypeGroup &group, const System::Requests &requested, vector<BaseDirectSystem::GroupColumn> &columns); // appends the group's columns in the argument order
+        [[nodiscard]] static bool IsArchetypeGroupChanged(const ArchetypeGroup &group, Array<const TypeId> types, ui64 sinceVersion);
+        void MarkArchetypeGroupWritten(ArchetypeGroup &group); // every component type of the group counts as written
+        [[nodiscard]] bool IsDirectSystemInputChanged(const ManagedDirectSystem &managed) const;
+        void ExecuteDirectSystem(BaseDirectSystem &system, ui64 &controlsCursor, System::Environment &env, ui64 changesSeenAt);
+        void ListenToControls(IKeyController::ListenerHandle &listener, System &system); // the system's ControlInput receives the actions and the ones it sends go to the controls log
+        void ProcessControlsLog(System &system, ui64 &controlsCursor); // dispatches the actions sent by the other systems since the cursor
+        [[nodiscard]] bool IsControlsLogPending(const System &system, ui64 controlsCursor) const;
+        void DrainInputRing(); // the actions go to the controls log without a sender
+        void TrimControlsLog();
+        void RebuildMessageRoutes();
+        [[nodiscard]] const vector<ManagedIndirectSystem *> &ComponentRoutes(TypeId type);
+        [[nodiscard]] const vector<ManagedIndirectSystem *> &ArchetypeRoutes(const Archetype &archetype);
+        void DetachComponentChangedViews(const ArchetypeGroup *group, TypeId type); // nullptr group or empty type match any
         void PatchComponentAddedMessages(MessageBuilder &messageBuilder);
         void PatchEntityRemovedArchetypes(MessageBuilder &messageBuilder);
+        [[nodiscard]] uiw PrepareComponentChangedApplyTasks(MessageBuilder &messageBuilder, bool isPartitioning); // returns the number of tasks
+        static void ApplyComponentChangedTask(const ComponentChangedApplyTask &task);
+        void ApplyComponentChangedTasks(uiw tasksCount, bool isParallel);
         void UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(MessageBuilder &messageBuilder);
+        void SortArchetypeGroups();
+        void SortArchetypeGroup(ArchetypeGroup &group, const ArchetypeGroup::ComponentArray &keyArray, const SortKeyFunction &keyFunction); // does nothing if the group is already sorted
         void PassMessagesToIndirectSystemsAndClear(MessageBuilder &messageBuilder, System *systemToIgnore);
-        static bool SendControlActionToQueue(ControlsQueue &controlsQueue, const ControlAction &action);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "PreHeader.hpp"
+#include "TransformHierarchy.hpp"
+#include <MathFunctions.hpp>
+
+using namespace ECSTest;
+
+auto TransformHierarchy::FindNode(EntityID id) -> Node *
+{
+	auto it = _nodes.find(id);
+	return it != _nodes.end() ? &it->second : nullptr;
+}
+
+void TransformHierarchy::LocalChanged(const Node &node)
+{
+	if (_isHierarchyChanged || node.level == ui32_max)
+	{
+		return; // all the matrices will be recomputed
+	}
+
+	Level &level = _levels[node.level];
+	level.locals[node.index] = Matrix4x3::CreateRTS(node.rotation, node.position, node.scale);
+	level.dirty[node.index] = 1;
+}
+
+void TransformHierarchy::RebuildLevels()
+{
+	_children.clear();
+	for (auto &level : _levels)
+	{
+		level = {};
+	}
+	_levels.resize(1);
+
+	for (auto &[id, node] : _nodes)
+	{
+		node.level = ui32_max;
+		if (node.parent.IsValid() && _nodes.count(node.parent))
+		{
+			_children[node.parent].push_back(id);
+		}
+		else
+		{
+			AddToLevel(0, id, node, ui32_max);
+		}
+	}
+
+	// breadth first, each level is built from the previous one
+	for (uiw levelIndex = 0; levelIndex < _levels.size(); ++levelIndex)
+	{
+		for (ui32 index = 0; index < _levels[levelIndex].ids.size(); ++index)
+		{
+			auto it = _children.find(_levels[levelIndex].ids[index]);
+			if (it == _children.end())
+			{
+				continue;
+			}
+			if (levelIndex + 1 == _levels.size())
+			{
+				_levels.emplace_back();
+			}
+			for (EntityID child : it->second)
+			{
+				AddToLevel(levelIndex + 1, child, _nodes.find(child)->second, index);
+			}
+		}
+	}
+
+	if (_levels.back().ids.empty())
+	{
+		_levels.pop_back();
+	}
+
+	// the entities that weren't reached from any root have the parents forming a cycle, they're ignored
+	_ignoredCount = 0;
+	for (const auto &[id, node] : _nodes)
+	{
+		_ignoredCount += node.level == ui32_max;
+	}
+}
+
+void TransformHierarchy::AddToLevel(uiw levelIndex, EntityID id, Node &node, ui32 parentIndex)
+{
+	Level &level = _levels[levelIndex];
+	node.level = static_cast<ui32>(levelIndex);
+	node.index = static_cast<ui32>(level.ids.size());
+	level.ids.push_back(id);
+	level.parents.push_back(parentIndex);
+	level.locals.push_back(Matrix4x3::CreateRTS(node.rotation, node.position, node.scale));
+	level.worlds.emplace_back();
+	level.dirty.push_back(1);
+	level.isWritingWorld.push_back(node.isWritingWorld);
+}
+
+uiw TransformHierarchy::CollectDirty(const Level &level)
+{
+	uiw count = level.ids.size();
+	if (_dirtyIndexes.size() < count)
+	{
+		_dirtyIndexes.resize(count);
+	}
+
+	// every index is written, only the dirty ones are kept
+	uiw dirtyCount = 0;
+	for (uiw index = 0; index < count; ++index)
+	{
+		_dirtyIndexes[dirtyCount] = static_cast<ui32>(index);
+		dirtyCount += level.dirty[index];
+	}
+	return dirtyCount;
+}
+
+void TransformHierarchy::Assign(EntityID id, const Vector3 &position, const Quaternion &rotation, const Vector3 &scale, EntityID parent, bool isWritingWorld)
+{
+	auto [it, isAdded] = _nodes.try_emplace(id);
+	Node &node = it->second;
+	node.position = position;
+	node.rotation = rotation;
+	node.scale = scale;
+
+	if (isAdded || node.parent != parent || node.isWritingWorld != isWritingWorld)
+	{
+		node.parent = parent;
+		node.isWritingWorld = isWritingWorld;
+		_isHierarchyChanged = true;
+	}
+	else
+	{
+		LocalChanged(node);
+	}
+}
+
+void TransformHierarchy::SetPosition(EntityID id, const Vector3 &position)
+{
+	if (Node *node = FindNode(id); node)
+	{
+		node->position = position;
+		LocalChanged(*node);
+	}
+}
+
+void TransformHierarchy::SetRotation(EntityID id, const Quaternion &rotation)
+{
+	if (Node *node = FindNode(id); node)
+	{
+		node->rotation = rotation;
+		LocalChanged(*node);
+	}
+}
+
+void TransformHierarchy::SetScale(EntityID id, const Vector3 &scale)
+{
+	if (Node *node = FindNode(id); node)
+	{
+		node->scale = scale;
+		LocalChanged(*node);
+	}
+}
+
+void TransformHierarchy::SetParent(EntityID id, EntityID parent)
+{
+	if (Node *node = FindNode(id); node && node->parent != parent)
+	{
+		node->parent = parent;
+		_isHierarchyChanged = true;
+	}
+}
+
+void TransformHierarchy::SetWritingWorld(EntityID id, bool isWritingWorld)
+{
+	if (Node *node = FindNode(id); node && node->isWritingWorld != isWritingWorld)
+	{
+		node->isWritingWorld = isWritingWorld;
+		_isHierarchyChanged = true;
+	}
+}
+
+void TransformHierarchy::Remove(EntityID id)
+{
+	if (_nodes.erase(id))
+	{
+		_isHierarchyChanged = true;
+	}
+}
+
+void TransformHierarchy::Update(vector<EntityID> &changedIds, vector<Matrix4x3> &changedWorlds)
+{
+	if (_isHierarchyChanged)
+	{
+		RebuildLevels();
+		_isHierarchyChanged = false;
+	}
+
+	// the levels go from the roots to the leaves, so the parents' world matrices are always up to date
+	for (uiw levelIndex = 0; levelIndex < _levels.size(); ++levelIndex)
+	{
+		Level &level = _levels[levelIndex];
+
+		if (levelIndex > 0)
+		{
+			const Level &parentLevel = _levels[levelIndex - 1];
+			for (uiw index = 0, count = level.ids.size(); index < count; ++index)
+			{
+				level.dirty[index] |= parentLevel.dirty[level.parents[index]];
+			}
+		}
+
+		uiw dirtyCount = CollectDirty(level);
+
+		if (levelIndex == 0)
+		{
+			for (uiw dirtyIndex = 0; dirtyIndex < dirtyCount; ++dirtyIndex)
+			{
+				ui32 index = _dirtyIndexes[dirtyIndex];
+				level.worlds[index] = level.locals[index];
+			}
+		}
+		else
+		{
+			Level &parentLevel = _levels[levelIndex - 1];
+			for (uiw dirtyIndex = 0; dirtyIndex < dirtyCount; ++dirtyIndex)
+			{
+				ui32 index = _dirtyIndexes[dirtyIndex];
+				level.worlds[index] = level.locals[index] * parentLevel.worlds[level.parents[index]];
+			}
+
+			std::fill(parentLevel.dirty.begin(), parentLevel.dirty.end(), ui8(0)); // not needed by the deeper levels
+		}
+
+		// every dirty entry is written, only those of the writing entities are kept
+		uiw outputCount = changedIds.size();
+		changedIds.resize(outputCount + dirtyCount);
+		changedWorlds.resize(outputCount + dirtyCount);
+		for (uiw dirtyIndex = 0; dirtyIndex < dirtyCount; ++dirtyIndex)
+		{
+			ui32 index = _dirtyIndexes[dirtyIndex];
+			changedIds[outputCount] = level.ids[index];
+			changedWorlds[outputCount] = level.worlds[index];
+			outputCount += level.isWritingWorld[index];
+		}
+		changedIds.resize(outputCount);
+		changedWorlds.resize(outputCount);
+	}
+
+	if (_levels.size())
+	{
+		std::fill(_levels.back().dirty.begin(), _levels.back().dirty.end(), ui8(0));
+	}
+}
+
+optional<Matrix4x3> TransformHierarchy::FindWorld(EntityID id) const
+{
+	auto it = _nodes.find(id);
+	if (it == _nodes.end() || it->second.level == ui32_max)
+	{
+		return nullopt;
+	}
+	return _levels[it->second.level].worlds[it->second.index];
+}
+
+optional<ui32> TransformHierarchy::FindDepth(EntityID id) const
+{
+	auto it = _nodes.find(id);
+	if (it == _nodes.end() || it->second.level == ui32_max)
+	{
+		return nullopt;
+	}
+	return it->second.level;
+}
+
+uiw TransformHierarchy::Size() const
+{
+	return _nodes.size();
+}
+
+uiw TransformHierarchy::LevelsCount() const
+{
+	return _levels.size();
+}
+
+uiw TransformHierarchy::IgnoredCount() const
+{
+	return _ignoredCount;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "EntityID.hpp"
+
+namespace ECSTest
+{
+    // copy of the entities' hierarchy ordered by depth, computes the world matrices from the local transforms,
+    // only the subtrees with changed local transforms or parents are recomputed
+    class TransformHierarchy
+    {
+		// the source data of an entity, the computed matrices live in the levels
+		struct Node
+		{
+			Vector3 position{};
+			Quaternion rotation{};
+			Vector3 scale{1, 1, 1};
+			EntityID parent{};
+			bool isWritingWorld = false;
+			ui32 level = ui32_max; // ui32_max if the node isn't placed yet
+			ui32 index = ui32_max;
+		};
+
+		// entities of the same depth stored as parallel arrays
+		struct Level
+		{
+			vector<EntityID> ids{};
+			vector<ui32> parents{}; // indexes within the previous level
+			vector<Matrix4x3> locals{};
+			vector<Matrix4x3> worlds{};
+			vector<ui8> dirty{};
+			vector<ui8> isWritingWorld{};
+		};
+
+		std::unordered_map<EntityID, Node> _nodes{};
+		std::unordered_map<EntityID, vector<EntityID>> _children{};
+		vector<Level> _levels{}; // index is the depth, the roots are at 0
+		vector<ui32> _dirtyIndexes{}; // indexes of the dirty entries of the level being updated
+		uiw _ignoredCount = 0;
+		bool _isHierarchyChanged = false;
+
+		[[nodiscard]] Node *FindNode(EntityID id);
+		void LocalChanged(const Node &node);
+		void RebuildLevels();
+		void AddToLevel(uiw levelIndex, EntityID id, Node &node, ui32 parentIndex);
+		[[nodiscard]] uiw CollectDirty(const Level &level); // fills _dirtyIndexes, returns their count
+
+	public:
+		void Assign(EntityID id, const Vector3 &position, const Quaternion &rotation, const Vector3 &scale, EntityID parent, bool isWritingWorld); // adds the entity if it's not stored yet
+		// the setters do nothing if the entity isn't stored
+		void SetPosition(EntityID id, const Vector3 &position);
+		void SetRotation(EntityID id, const Quaternion &rotation);
+		void SetScale(EntityID id, const Vector3 &scale);
+		void SetParent(EntityID id, EntityID parent);
+		void SetWritingWorld(EntityID id, bool isWritingWorld);
+		void Remove(EntityID id); // the children become roots
+
+		// recomputes the changed world matrices, those of the writing entities are appended to changedIds and changedWorlds
+		void Update(vector<EntityID> &changedIds, vector<Matrix4x3> &changedWorlds);
+
+		// as of the last Update, nullopt if the entity isn't placed in the hierarchy
+		[[nodiscard]] optional<Matrix4x3> FindWorld(EntityID id) const;
+		[[nodiscard]] optional<ui32> FindDepth(EntityID id) const;
+		[[nodiscard]] uiw Size() const;
+		[[nodiscard]] uiw LevelsCount() const;
+		[[nodiscard]] uiw IgnoredCount() const; // entities whose parents form a cycle
+    };
+}
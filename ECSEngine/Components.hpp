@@ -39,6 +39,12 @@ namespace ECSEngine
 
 	struct HasChildren : TagComponent<HasChildren> {};
 
+	// computed by TransformHierarchySystem from the local Position, Rotation and Scale of the entity and its ancestors
+	struct WorldTransform : Component<WorldTransform>
+	{
+		Matrix4x3 matrix{};
+	};
+
     struct MeshRenderer : NonUniqueComponent<MeshRenderer>
     {
 		MeshAssetId mesh{};
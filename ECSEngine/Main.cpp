@@ -8,6 +8,8 @@
 #include "PhysicsSystem.hpp"
 #include "AssetsLoaders.hpp"
 #include "SetInitialPositionsSystem.hpp"
+#include "SpatialIndexSystem.hpp"
+#include "TransformHierarchySystem.hpp"
 #include "ObjectShooterSystem.hpp"
 #include "AssetsIdentification.hpp"
 
@@ -50,7 +52,11 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int)
     auto rendererKeyController = KeyController::New();
     InputHandle = rendererKeyController->OnControlAction(ReceiveInput);
 
-    auto renderer = RendererDX11System::New();
+    // the window input reaches the systems through the ring instead of the renderer's key controller
+    auto inputRing = make_shared<ControlsRing>();
+    manager->SetInputRing(inputRing);
+
+    auto renderer = RendererDX11System::New(inputRing);
     renderer->SetKeyController(rendererKeyController);
 
 	auto cameraMovementSystem = make_unique<CameraMovementSystem>();
@@ -59,6 +65,9 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int)
 	auto setInitialPositionsSystem = make_unique<SetInitialPositionSystem>();
 	setInitialPositionsSystem->SetKeyController(KeyController::New());
 
+	// keeps the entities with the same mesh and materials next to each other, so the renderer can batch them
+	manager->SetSortKey<MeshRenderer>([](const MeshRenderer &renderer) { return (static_cast<ui64>(renderer.mesh.Hash()) << 32) | renderer.materials.Hash(); });
+
     auto rendererPipeline = manager->CreatePipeline(nullopt, false);
     manager->Register(move(renderer), rendererPipeline);
 
@@ -66,9 +75,11 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int)
 	//manager->Register<ObjectsMoverSystem>(physicsPipeline);
 	manager->Register(move(cameraMovementSystem), physicsPipeline);
 	manager->Register(move(setInitialPositionsSystem), physicsPipeline);
+	manager->Register<SpatialIndexSystem>(physicsPipeline);
 
 	PhysicsSystemSettings physicsSystemSettings{};
 	manager->Register(PhysicsSystem::New(physicsSystemSettings), physicsPipeline);
+	manager->Register(TransformHierarchySystem::New(), physicsPipeline);
 
 	auto assetIdMapper = make_shared<AssetIdMapper>();
 
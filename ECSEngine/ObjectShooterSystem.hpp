@@ -7,8 +7,22 @@ namespace ECSEngine
 {
 	struct ObjectShooterSystem : IndirectSystem<ObjectShooterSystem>
 	{
-		ObjectShooterSystem(const EntityObject &referenceEntity) : _referenceEntity(referenceEntity)
-		{}
+		ObjectShooterSystem(const EntityObject &referenceEntity)
+		{
+			ComponentArrayBuilder components;
+			for (const auto &r : referenceEntity.components.GetComponents())
+			{
+				if (r.type == Position::GetTypeId() || r.type == Rotation::GetTypeId() || r.type == LinearVelocity::GetTypeId())
+				{
+					continue;
+				}
+				components.AddComponent(r);
+			}
+			components.AddComponent(Position());
+			components.AddComponent(LinearVelocity());
+			components.AddComponent(Rotation());
+			_projectilePrefab = Prefab(components.GetComponents());
+		}
 
 		void Accept(const Array<Position> &positions, const Array<Rotation> &rotations, RequiredComponent<Camera, ActiveCamera>) {}
 		
@@ -51,13 +65,10 @@ namespace ECSEngine
 				}
 			}
 		}
-		
-		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentRemoved &stream) override
-		{
-		}
-		
-		virtual void ProcessMessages(System::Environment &env, const MessageStreamEntityRemoved &stream) override
+
+		virtual MessageTypes::MessageType AcceptedMessageTypes() const override
 		{
+			return MessageTypes::RegisterEntity.Combined(MessageTypes::ComponentAdded).Combined(MessageTypes::ComponentChanged);
 		}
 		
 		virtual void ControlInput(Environment &env, const ControlAction &action) override
@@ -66,18 +77,9 @@ namespace ECSEngine
 			{
 				if (key->key == KeyCode::MouseSecondary && key->keyState != ControlAction::Key::KeyState::Released)
 				{
-					EntityID id = env.messageBuilder.AddEntity("procedural sphere");
-					for (const auto &r : _referenceEntity.components.GetComponents())
-					{
-						if (r.type == Position::GetTypeId() || r.type == Rotation::GetTypeId() || r.type == LinearVelocity::GetTypeId())
-						{
-							continue;
-						}
-						env.messageBuilder.AddComponent(id, r);
-					}
-					env.messageBuilder.AddComponent(id, Position{.position = _cameraTransform.Position() + _cameraTransform.ForwardAxis() * 2 - _cameraTransform.UpAxis()});
-					env.messageBuilder.AddComponent(id, LinearVelocity{.velocity = _cameraTransform.ForwardAxis() * 25});
-					env.messageBuilder.AddComponent(id, Rotation());
+					auto instances = env.messageBuilder.Instantiate(_projectilePrefab, 1, "procedural sphere");
+					instances.Column<Position>()[0].position = _cameraTransform.Position() + _cameraTransform.ForwardAxis() * 2 - _cameraTransform.UpAxis();
+					instances.Column<LinearVelocity>()[0].velocity = _cameraTransform.ForwardAxis() * 25;
 				}
 			}
 		}
@@ -85,6 +87,6 @@ namespace ECSEngine
 	private:
 		EntityID _controllingCamera{};
 		CameraTransform _cameraTransform{};
-		EntityObject _referenceEntity{};
+		Prefab _projectilePrefab{};
 	};
 }
\ No newline at end of file
@@ -47,25 +47,26 @@ struct PhysXSystem : PhysicsSystem
 		_physXScene->simulate(env.timeSinceLastFrame, nullptr, _simulationMemory.get(), _simulationMemorySize);
 		_physXScene->fetchResults(true);
 
-		env.messageBuilder.ComponentChangedHint(Position::Description(), _awakeActors.size());
-		env.messageBuilder.ComponentChangedHint(Rotation::Description(), _awakeActors.size());
-
+		_awakeIds.clear();
 		for (PxActor *actor : _awakeActors)
 		{
+			_awakeIds.push_back(GetUserData(actor));
+		}
+
+		auto positions = env.messageBuilder.ComponentChangedReserve<Position>(ToArray(_awakeIds));
+		auto rotations = env.messageBuilder.ComponentChangedReserve<Rotation>(ToArray(_awakeIds));
+
+		for (uiw index = 0; index < _awakeActors.size(); ++index)
+		{
+			PxActor *actor = _awakeActors[index];
 			ASSUME(actor->is<PxRigidActor>());
 
-			EntityID id = GetUserData(actor);
 			const PxRigidActor *rigid = static_cast<const PxRigidActor *>(actor);
 
 			const auto &phyPos = rigid->getGlobalPose();
 
-			Position pos;
-			pos.position = {phyPos.p.x, phyPos.p.y, phyPos.p.z};
-			env.messageBuilder.ComponentChanged(id, pos);
-
-			Rotation rot;
-			rot.rotation = {phyPos.q.x, phyPos.q.y, phyPos.q.z, phyPos.q.w};
-			env.messageBuilder.ComponentChanged(id, rot);
+			positions[index].position = {phyPos.p.x, phyPos.p.y, phyPos.p.z};
+			rotations[index].rotation = {phyPos.q.x, phyPos.q.y, phyPos.q.z, phyPos.q.w};
 		}
 	}
 	
@@ -696,6 +697,7 @@ private:
 	std::unordered_map<PhysicsPropertiesAssetId, PhysicsProperties> _cachedPhysicsProperties{};
 	vector<PxActor *> _awakeActors{};
 	std::unordered_map<PxActor *, uiw> _awakeActorsLookup{};
+	vector<EntityID> _awakeIds{}; // ids of _awakeActors, used when sending their changes
 
 	PxDefaultAllocator _defaultAllocator{};
 	PxDefaultErrorCallback _defaultErrorCallback{};
@@ -656,6 +656,9 @@ private:
 class RendereDX11SystemImpl : public RendererDX11System
 {
 public:
+    RendereDX11SystemImpl(const shared_ptr<ControlsRing> &inputRing) : _inputRing(inputRing)
+    {}
+
     virtual void ControlInput(Environment &env, const ControlAction &input) override
     {
     }
@@ -875,7 +878,7 @@ public:
             {
                 isChanged |= camera.windows[windowIndex].isChanged;
                 camera.windows[windowIndex].isChanged = false;
-                env.keyController->Dispatch(camera.windows[windowIndex].controlsQueue);
+                SendControls(env, camera.windows[windowIndex].controlsQueue.Actions());
                 camera.windows[windowIndex].controlsQueue.clear();
             }
 
@@ -893,7 +896,7 @@ public:
             custom.type = event->GetTypeId();
             custom.data = move(event);
             ControlAction action(custom, {}, {});
-            env.keyController->Dispatch(action);
+            SendControls(env, {&action, 1});
         }
     }
 
@@ -1023,6 +1026,27 @@ public:
     }
 
 private:
+	// through the ring the actions reach every system with a key controller, the renderer included, at the start of the next frame
+	void SendControls(Environment &env, Array<const ControlAction> actions)
+	{
+		if (_inputRing == nullptr)
+		{
+			for (const ControlAction &action : actions)
+			{
+				env.keyController->Dispatch(action);
+			}
+			return;
+		}
+
+		for (const ControlAction &action : actions)
+		{
+			if (_inputRing->Push(action) == false)
+			{
+				env.logger.Warning("Input ring is full, a control action was dropped\n");
+			}
+		}
+	}
+
 	void AddMeshRenderer(Environment &env, EntityID id, ComponentID componentId, const MeshRenderer &meshRenderer, const Vector3 &position, const Quaternion &rotation, const Scale *scale)
 	{
 		auto &vec = _meshRendererObjects[id];
@@ -1203,11 +1227,12 @@ private:
 	COMUniquePtr<ID3D11Buffer> _uniformBuffer{};
 	LayoutManager _layoutManager{};
 	std::unordered_map<MeshAssetId, shared_ptr<MeshResource>> _meshResources{};
+	shared_ptr<ControlsRing> _inputRing{};
 };
 
-unique_ptr<Renderer> RendererDX11System::New()
+unique_ptr<Renderer> RendererDX11System::New(const shared_ptr<ControlsRing> &inputRing)
 {
-    return make_unique<RendereDX11SystemImpl>();
+    return make_unique<RendereDX11SystemImpl>(inputRing);
 }
 
 optional<HWND> CreateSystemWindow(LoggerWrapper &logger, const string &title, bool isFullscreen, bool hideBorders, bool isMaximized, RECT &dimensions, Window::CursorTypet cursorType, void *userData)
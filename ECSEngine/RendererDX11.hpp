@@ -20,6 +20,6 @@ namespace ECSEngine
 			return TypeIdentifiable<RendererDX11System>::GetTypeName();
 		}
 
-        static unique_ptr<Renderer> New();
+        static unique_ptr<Renderer> New(const shared_ptr<ControlsRing> &inputRing = {}); // the window input goes into the ring if it's set, otherwise it's dispatched to the renderer's key controller
     };
 }
\ No newline at end of file
@@ -27,9 +27,10 @@ namespace ECSEngine
 				_initialPositions[entry.entityID] = {entry.GetComponent<Position>(), entry.GetComponent<Rotation>()};
 			}
 		}
-		
-		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentChanged &stream) override
+
+		virtual MessageTypes::MessageType AcceptedMessageTypes() const override
 		{
+			return MessageTypes::RegisterEntity.Combined(MessageTypes::ComponentAdded).Combined(MessageTypes::ComponentRemoved).Combined(MessageTypes::UnregisterEntity);
 		}
 		
 		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentRemoved &stream) override
@@ -58,12 +59,21 @@ namespace ECSEngine
 			{
 				if (key->key == KeyCode::Space && key->keyState == ControlAction::Key::KeyState::Pressed)
 				{
-					env.messageBuilder.ComponentChangedHint(Position::Description(), _initialPositions.size());
-					env.messageBuilder.ComponentChangedHint(Rotation::Description(), _initialPositions.size());
-					for (auto &[id, posrot] : _initialPositions)
+					_ids.clear();
+					for (const auto &[id, posrot] : _initialPositions)
+					{
+						_ids.push_back(id);
+					}
+
+					auto positions = env.messageBuilder.ComponentChangedReserve<Position>(ToArray(_ids));
+					auto rotations = env.messageBuilder.ComponentChangedReserve<Rotation>(ToArray(_ids));
+
+					uiw index = 0;
+					for (const auto &[id, posrot] : _initialPositions)
 					{
-						env.messageBuilder.ComponentChanged(id, posrot.first);
-						env.messageBuilder.ComponentChanged(id, posrot.second);
+						positions[index] = posrot.first;
+						rotations[index] = posrot.second;
+						++index;
 					}
 				}
 			}
@@ -71,5 +81,6 @@ namespace ECSEngine
 
 	private:
 		std::unordered_map<EntityID, pair<Position, Rotation>> _initialPositions{};
+		vector<EntityID> _ids{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <SystemCreation.hpp>
+
+namespace ECSEngine
+{
+	// keeps env.spatialIndex in sync with the entities' positions, the other systems can use it for range queries
+	struct SpatialIndexSystem : IndirectSystem<SpatialIndexSystem>
+	{
+		void Accept(const Array<Position> &positions) {}
+
+		virtual void Update(Environment &env) override
+		{
+		}
+
+		virtual void ProcessMessages(System::Environment &env, const MessageStreamRegisterEntity &stream) override
+		{
+			for (const auto &entry : stream)
+			{
+				Add(entry.entityID, entry.GetComponent<Position>().position);
+			}
+			Flush(env);
+		}
+
+		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentAdded &stream) override
+		{
+			if (stream.Type() != Position::GetTypeId())
+			{
+				return;
+			}
+			for (const auto &entry : stream)
+			{
+				Add(entry.entityID, entry.added.Cast<Position>().position);
+			}
+			Flush(env);
+		}
+
+		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentChanged &stream) override
+		{
+			for (const auto &entry : stream.Enumerate<Position>())
+			{
+				Add(entry.entityID, entry.component.position);
+			}
+			Flush(env);
+		}
+
+		virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentRemoved &stream) override
+		{
+			for (const auto &entry : stream.Enumerate<Position>())
+			{
+				env.spatialIndex.Remove(entry.entityID);
+			}
+		}
+
+		virtual void ProcessMessages(System::Environment &env, const MessageStreamUnregisterEntity &stream) override
+		{
+			for (auto id : stream)
+			{
+				env.spatialIndex.Remove(id);
+			}
+		}
+
+		virtual MessageTypes::MessageType AcceptedMessageTypes() const override
+		{
+			return MessageTypes::RegisterEntity.Combined(MessageTypes::ComponentAdded).Combined(MessageTypes::ComponentChanged).Combined(MessageTypes::ComponentRemoved).Combined(MessageTypes::UnregisterEntity);
+		}
+
+		virtual bool IsReactive() const override
+		{
+			return true; // all the work is done when processing the messages
+		}
+
+	private:
+		void Add(EntityID id, const Vector3 &position)
+		{
+			_ids.push_back(id);
+			_positions.push_back(position);
+		}
+
+		// the positions are passed as a single batch, this way the index computes their cells in one pass
+		void Flush(System::Environment &env)
+		{
+			env.spatialIndex.Update(ToArray(_ids), ToArray(_positions));
+			_ids.clear();
+			_positions.clear();
+		}
+
+		vector<EntityID> _ids{};
+		vector<Vector3> _positions{};
+	};
+}
@@ -0,0 +1,127 @@
+#include "PreHeader.hpp"
+#include "TransformHierarchySystem.hpp"
+
+using namespace ECSEngine;
+
+struct TransformHierarchySystemImpl : TransformHierarchySystem
+{
+	virtual void Update(Environment &env) override
+	{
+		_hierarchy.Update(_changedIds, _changedWorlds);
+		for (uiw index = 0; index < _changedIds.size(); ++index)
+		{
+			WorldTransform world;
+			world.matrix = _changedWorlds[index];
+			env.messageBuilder.ComponentChanged(_changedIds[index], world);
+		}
+		_changedIds.clear();
+		_changedWorlds.clear();
+
+		if (_hierarchy.IgnoredCount() != _reportedIgnoredCount)
+		{
+			_reportedIgnoredCount = _hierarchy.IgnoredCount();
+			env.logger.Warning("TransformHierarchySystem -> %zu entities are ignored, their parents form a cycle\n", _reportedIgnoredCount);
+		}
+	}
+
+	virtual void ProcessMessages(System::Environment &env, const MessageStreamRegisterEntity &stream) override
+	{
+		for (const auto &entry : stream)
+		{
+			Assign(entry.entityID, entry);
+		}
+	}
+
+	virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentAdded &stream) override
+	{
+		for (const auto &entry : stream)
+		{
+			Assign(entry.entityID, entry);
+		}
+	}
+
+	virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentChanged &stream) override
+	{
+		for (const auto &entry : stream.Enumerate<Position>())
+		{
+			_hierarchy.SetPosition(entry.entityID, entry.component.position);
+		}
+		for (const auto &entry : stream.Enumerate<Rotation>())
+		{
+			_hierarchy.SetRotation(entry.entityID, entry.component.rotation);
+		}
+		for (const auto &entry : stream.Enumerate<Scale>())
+		{
+			_hierarchy.SetScale(entry.entityID, entry.component.scale);
+		}
+		for (const auto &entry : stream.Enumerate<Parent>())
+		{
+			_hierarchy.SetParent(entry.entityID, entry.component.parent);
+		}
+	}
+
+	virtual void ProcessMessages(System::Environment &env, const MessageStreamComponentRemoved &stream) override
+	{
+		for (const auto &entry : stream.Enumerate<Position>())
+		{
+			_hierarchy.Remove(entry.entityID);
+		}
+		for (const auto &entry : stream.Enumerate<Rotation>())
+		{
+			_hierarchy.Remove(entry.entityID);
+		}
+		for (const auto &entry : stream.Enumerate<Scale>())
+		{
+			_hierarchy.SetScale(entry.entityID, {1, 1, 1});
+		}
+		for (const auto &entry : stream.Enumerate<Parent>())
+		{
+			_hierarchy.SetParent(entry.entityID, {});
+		}
+		for (const auto &entry : stream.Enumerate<WorldTransform>())
+		{
+			_hierarchy.SetWritingWorld(entry.entityID, false);
+		}
+	}
+
+	virtual void ProcessMessages(System::Environment &env, const MessageStreamUnregisterEntity &stream) override
+	{
+		for (auto id : stream)
+		{
+			_hierarchy.Remove(id);
+		}
+	}
+
+	virtual MessageTypes::MessageType AcceptedMessageTypes() const override
+	{
+		return MessageTypes::RegisterEntity.Combined(MessageTypes::ComponentAdded).Combined(MessageTypes::ComponentChanged).Combined(MessageTypes::ComponentRemoved).Combined(MessageTypes::UnregisterEntity);
+	}
+
+	virtual bool IsReactive() const override
+	{
+		return true; // the matrices change only in response to the messages
+	}
+
+private:
+	template <typename T> void Assign(EntityID id, const T &entry)
+	{
+		auto *scale = entry.template FindComponent<Scale>();
+		auto *parent = entry.template FindComponent<Parent>();
+		_hierarchy.Assign(id,
+			entry.template GetComponent<Position>().position,
+			entry.template GetComponent<Rotation>().rotation,
+			scale ? scale->scale : Vector3{1, 1, 1},
+			parent ? parent->parent : EntityID{},
+			entry.template FindComponent<WorldTransform>() != nullptr);
+	}
+
+	TransformHierarchy _hierarchy{};
+	vector<EntityID> _changedIds{};
+	vector<Matrix4x3> _changedWorlds{};
+	uiw _reportedIgnoredCount = 0;
+};
+
+unique_ptr<TransformHierarchySystem> TransformHierarchySystem::New()
+{
+	return make_unique<TransformHierarchySystemImpl>();
+}
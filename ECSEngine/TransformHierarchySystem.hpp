@@ -0,0 +1,21 @@
+#pragma once
+
+#include <SystemCreation.hpp>
+#include <TransformHierarchy.hpp>
+#include "Components.hpp"
+
+namespace ECSEngine
+{
+	// keeps a copy of the entities' hierarchy ordered by depth and writes WorldTransform of the entities that have it,
+	// only the subtrees with changed local transforms or parents are recomputed
+	struct TransformHierarchySystem : IndirectSystem<TransformHierarchySystem>
+	{
+		void Accept(const Array<Position> &,
+			const Array<Rotation> &,
+			const Array<Scale> *,
+			const Array<Parent> *,
+			Array<WorldTransform> *) {}
+
+		[[nodiscard]] static unique_ptr<TransformHierarchySystem> New();
+	};
+}
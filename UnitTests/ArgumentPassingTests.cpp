@@ -9,6 +9,7 @@ class ArgumentPassingTestsClass
 	static inline std::atomic<bool> IsSystem0Visited;
 	static inline std::atomic<bool> IsSystem1Visited;
 	static inline std::atomic<bool> IsSystem2Visisted;
+	static inline std::atomic<bool> IsSystem8Visited;
 
 public:
 	ArgumentPassingTestsClass()
@@ -16,6 +17,7 @@ public:
 		IsSystem0Visited = false;
 		IsSystem1Visited = false;
 		IsSystem2Visisted = false;
+		IsSystem8Visited = false;
 
 		auto idGenerator = EntityIDGenerator{};
 		auto manager = SystemsManager::New(IsMTECS, Log);
@@ -36,6 +38,7 @@ public:
 		manager->Register<System5>(pipeline);
 		manager->Register<System6>(pipeline);
 		manager->Register<System7>(pipeline);
+		manager->Register<System8>(pipeline);
 
 		vector<WorkerThread> workers;
 		if (IsMTECS)
@@ -57,7 +60,7 @@ public:
 
 		manager->Stop(true);
 
-		ASSUME(IsSystem0Visited && IsSystem1Visited && IsSystem2Visisted);
+		ASSUME(IsSystem0Visited && IsSystem1Visited && IsSystem2Visisted && IsSystem8Visited);
 	}
 
 	struct ComponentBase
@@ -253,6 +256,26 @@ public:
 		}
 	};
 
+	struct System8 : ForEachSystem<System8>
+	{
+		void Update(const Component0 &c0, EntityID id, const Component1 *c1, SubtractiveComponent<Component2, Tag0>, Environment &env)
+		{
+			IsSystem8Visited = true;
+			ASSUME(id);
+			ASSUME(c0.Contains(Component0::GetTypeId()));
+			ASSUME(!c0.Contains(Component2::GetTypeId()));
+			ASSUME(!c0.Contains(Tag0::GetTypeId()));
+			if (c1)
+			{
+				ASSUME(c0 == *c1);
+			}
+			else
+			{
+				ASSUME(!c0.Contains(Component1::GetTypeId()));
+			}
+		}
+	};
+
 	struct System5 : IndirectSystem<System5>
 	{
 		using BaseIndirectSystem::ProcessMessages;
@@ -5,7 +5,8 @@ using namespace ECSTest;
 namespace
 {
 	static constexpr bool IsMTECS = false;
-	static constexpr ui32 EntitiesToTest = 1000;
+	static constexpr bool IsParallelForEach = true; // the rows of each group are split between the ST manager's workers
+	static constexpr ui32 EntitiesToTest = IsParallelForEach ? 16384 : 1000; // smaller groups aren't split, see ForEachSystem::minimalRowsPerThread
 }
 
 volatile ui32 EntitiesToTestExternal = EntitiesToTest;
@@ -34,8 +35,12 @@ public:
 		{
 			workers.resize(SystemInfo::LogicalCPUCores());
 		}
+		else if (IsParallelForEach)
+		{
+			workers.resize(SystemInfo::LogicalCPUCores() - 1); // the scheduler thread takes part as well
+		}
 
-		MesasureReference();
+		f64 reference = MesasureReference();
 
 		manager->Start(move(idGenerator), move(workers), move(stream));
 
@@ -55,7 +60,7 @@ public:
 
 		auto computed = pipelineInfo.executedTimes * 4 * EntitiesToTest;
 		auto time = managerInfo.timeSinceStart.ToSec_f64();
-		Log->Info("", "%.2lfkk sin/cos per second (ECS %s)\n", (computed / time) / 1000 / 1000, IsMTECS ? "multithreaded" : "singlethreaded");
+		Log->Info("", "%.2lfkk sin/cos per second (ECS %s, ForEach %s), reference %.2lfkk\n", (computed / time) / 1000 / 1000, IsMTECS ? "multithreaded" : "singlethreaded", IsParallelForEach ? "parallel" : "sequential", reference);
 	}
 
     struct CosineResultComponent : Component<CosineResultComponent>
@@ -78,55 +83,39 @@ public:
 	struct Group2Tag : TagComponent<Group2Tag> {};
 	struct Group3Tag : TagComponent<Group3Tag> {};
 
-    struct System0 : DirectSystem<System0>
+    struct System0 : ForEachSystem<System0, IsParallelForEach>
     {
-        void Accept(Array<CosineResultComponent> &cosine, Array<SinusResultComponent> &sinus, const Array<SourceComponent> &sources, RequiredComponent<Group0Tag>)
+        void Update(CosineResultComponent &cosine, SinusResultComponent &sinus, const SourceComponent &source, RequiredComponent<Group0Tag>)
         {
-            ASSUME(cosine.size() == sinus.size() && sinus.size() == sources.size());
-            for (uiw index = 0; index < cosine.size(); ++index)
-            {
-                cosine[index].value = cos(sources[index].value);
-                sinus[index].value = sin(sources[index].value);
-            }
+            cosine.value = cos(source.value);
+            sinus.value = sin(source.value);
         }
     };
 
-    struct System1 : DirectSystem<System1>
+    struct System1 : ForEachSystem<System1, IsParallelForEach>
     {
-		void Accept(Array<CosineResultComponent> &cosine, Array<SinusResultComponent> &sinus, const Array<SourceComponent> &sources, RequiredComponent<Group1Tag>)
+        void Update(CosineResultComponent &cosine, SinusResultComponent &sinus, const SourceComponent &source, RequiredComponent<Group1Tag>)
         {
-            ASSUME(cosine.size() == sinus.size() && sinus.size() == sources.size());
-            for (uiw index = 0; index < cosine.size(); ++index)
-            {
-                cosine[index].value = cos(sources[index].value);
-                sinus[index].value = sin(sources[index].value);
-            }
+            cosine.value = cos(source.value);
+            sinus.value = sin(source.value);
         }
     };
 
-    struct System2 : DirectSystem<System2>
+    struct System2 : ForEachSystem<System2, IsParallelForEach>
     {
-		void Accept(Array<CosineResultComponent> &cosine, Array<SinusResultComponent> &sinus, const Array<SourceComponent> &sources, RequiredComponent<Group2Tag>)
+        void Update(CosineResultComponent &cosine, SinusResultComponent &sinus, const SourceComponent &source, RequiredComponent<Group2Tag>)
         {
-            ASSUME(cosine.size() == sinus.size() && sinus.size() == sources.size());
-            for (uiw index = 0; index < cosine.size(); ++index)
-            {
-                cosine[index].value = cos(sources[index].value);
-                sinus[index].value = sin(sources[index].value);
-            }
+            cosine.value = cos(source.value);
+            sinus.value = sin(source.value);
         }
     };
 
-    struct System3 : DirectSystem<System3>
+    struct System3 : ForEachSystem<System3, IsParallelForEach>
     {
-		void Accept(Array<CosineResultComponent> &cosine, Array<SinusResultComponent> &sinus, const Array<SourceComponent> &sources, RequiredComponent<Group3Tag>)
+        void Update(CosineResultComponent &cosine, SinusResultComponent &sinus, const SourceComponent &source, RequiredComponent<Group3Tag>)
         {
-            ASSUME(cosine.size() == sinus.size() && sinus.size() == sources.size());
-            for (uiw index = 0; index < cosine.size(); ++index)
-            {
-                cosine[index].value = cos(sources[index].value);
-                sinus[index].value = sin(sources[index].value);
-            }
+            cosine.value = cos(source.value);
+            sinus.value = sin(source.value);
         }
     };
 
@@ -158,7 +147,7 @@ public:
         generate(Group3Tag{});
     }
 
-    static void MesasureReference()
+    static f64 MesasureReference() // returns kk sin/cos per second
     {
         auto entitiesToTest = EntitiesToTestExternal;
         auto cosine = make_unique<CosineResultComponent[]>(entitiesToTest);
@@ -196,7 +185,9 @@ public:
 
         auto computed = executedTimes * entitiesToTest;
         auto time = diff.ToSec_f64();
-        Log->Info("", "%.2lfkk sin/cos per second (reference 1 thread)\n", (computed / time) / 1000 / 1000);
+        f64 result = (computed / time) / 1000 / 1000;
+        Log->Info("", "%.2lfkk sin/cos per second (reference 1 thread)\n", result);
+        return result;
     }
 };
 
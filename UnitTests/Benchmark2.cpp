@@ -168,19 +168,17 @@ public:
 
 			uiw updateCount = _updateIdsList.size();
 
-			if (IsPhysicsUsingComponentChangedHints)
-			{
-				env.messageBuilder.ComponentChangedHint(Position::Description(), updateCount);
-				env.messageBuilder.ComponentChangedHint(Rotation::Description(), updateCount);
-			}
+			uiw countHint = IsPhysicsUsingComponentChangedHints ? updateCount : 0;
 
+			auto positionStream = env.messageBuilder.ComponentChangedStream<Position>(countHint);
 			for (uiw index = 0; index < updateCount; ++index)
 			{
-				env.messageBuilder.ComponentChanged(_updateIdsList[index], Position{_updatePositionsList[index]});
+				positionStream.ComponentChanged(_updateIdsList[index], Position{_updatePositionsList[index]});
 			}
+			auto rotationStream = env.messageBuilder.ComponentChangedStream<Rotation>(countHint);
 			for (uiw index = 0; index < updateCount; ++index)
 			{
-				env.messageBuilder.ComponentChanged(_updateIdsList[index], Rotation{_updateRotationsList[index]});
+				rotationStream.ComponentChanged(_updateIdsList[index], Rotation{_updateRotationsList[index]});
 			}
         }
 
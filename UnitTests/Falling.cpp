@@ -426,24 +426,29 @@ public:
 
         virtual void Update(Environment &env) override
         {
-            if (!_isChanged)
+            // the heights are read directly from the manager instead of being mirrored from the messages
+            f64 sum = 0;
+            ui32 sources = 0;
+            env.directQuery->ForEach([&sum, &sources](const Array<Transform> &transforms)
             {
-                return;
-            }
+                for (const auto &transform : transforms)
+                {
+                    sum += transform.position.y;
+                }
+                sources += static_cast<ui32>(transforms.size());
+            });
 
-            f64 sum = 0;
-            for (auto &[id, y] : _entities)
+            if (sources == 0 || (sum == _lastSum && sources == _lastSources))
             {
-                sum += y;
+                return;
             }
-            sum /= _entities.size();
+            _lastSum = sum;
+            _lastSources = sources;
 
             AverageHeight h;
-            h.height = static_cast<f32>(sum);
-            h.sources = static_cast<ui32>(_entities.size());
+            h.height = static_cast<f32>(sum / sources);
+            h.sources = sources;
             env.messageBuilder.ComponentChanged(_entityID, h);
-
-            _isChanged = false;
         }
 
         virtual void OnCreate(Environment &env) override
@@ -462,59 +467,14 @@ public:
             env.messageBuilder.RemoveEntity(_entityID);
         }
 
-        virtual void ProcessMessages(Environment &env, const MessageStreamRegisterEntity &stream) override
-        {
-            for (auto &entity : stream)
-            {
-                _entities[entity.entityID] = entity.FindComponent<Transform>()->position.y;
-            }
-            _isChanged = true;
-        }
-
-        virtual void ProcessMessages(Environment &env, const MessageStreamComponentAdded &stream) override
+        virtual MessageTypes::MessageType AcceptedMessageTypes() const override
         {
-            for (auto &entity : stream)
-            {
-                if (stream.Type() == Transform::GetTypeId())
-                {
-                    _entities[entity.entityID] = entity.added.Cast<Transform>().position.y;
-                    _isChanged = true;
-                }
-            }
-        }
-
-        virtual void ProcessMessages(Environment &env, const MessageStreamComponentChanged &stream) override
-        {
-			ASSUME(stream.Type() == Transform::GetTypeId());
-            for (auto entity : stream.Enumerate<Transform>())
-            {
-                _entities[entity.entityID] = entity.component.position.y;
-            }
-            _isChanged = true;
-        }
-
-        virtual void ProcessMessages(Environment &env, const MessageStreamComponentRemoved &stream) override
-        {
-			ASSUME(stream.Type() == Transform::GetTypeId());
-            for (const auto &entity : stream.Enumerate<Transform>())
-            {
-                _entities.erase(entity.entityID);
-            }
-            _isChanged = true;
-        }
-
-        virtual void ProcessMessages(Environment &env, const MessageStreamUnregisterEntity &stream) override
-        {
-            for (auto &entity : stream)
-            {
-                _entities.erase(entity);
-            }
-            _isChanged = true;
+            return MessageTypes::_None;
         }
 
     private:
-        std::map<EntityID, f32> _entities{};
-        bool _isChanged = false;
+        f64 _lastSum = 0;
+        ui32 _lastSources = 0;
         EntityID _entityID{};
     };
 
@@ -51,10 +51,13 @@
 #include <UnitTestsLogger.hpp>
 #include <NativeConsole.hpp>
 #include <SystemsManager.hpp>
+#include <SystemsManagerST.hpp>
 #include <SystemCreation.hpp>
+#include <DirectQuery.hpp>
 #include <EntitiesStreamBuilder.hpp>
 #include <KeyController.hpp>
 #include <ArchetypeReflector.hpp>
+#include <TransformHierarchy.hpp>
 #include <set>
 #include <stdio.h>
 #include <tuple>
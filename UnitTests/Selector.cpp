@@ -8,6 +8,7 @@ void PerformUnitTests(bool isSuppressLogs);
 void SimpleOrderTests();
 void Benchmark();
 void Benchmark2();
+void SpatialBenchmark();
 void KeyControllerTests();
 void SyncTests();
 void Falling();
@@ -26,7 +27,8 @@ namespace
 		SyncTests,
 		Benchmark,
 		Falling,
-		Benchmark2
+		Benchmark2,
+		SpatialBenchmark
 	};
 }
 
@@ -86,6 +88,7 @@ int main()
 	Log->Info("", "%i. Benchmark\n", value++);
 	Log->Info("", "%i. Falling\n", value++);
 	Log->Info("", "%i. Benchmark2\n", value++);
+	Log->Info("", "%i. SpatialBenchmark\n", value++);
 
 restart:
     int choice = 0;
@@ -0,0 +1,81 @@
+#include "PreHeader.hpp"
+
+using namespace ECSTest;
+
+class SpatialBenchmarkClass
+{
+	static constexpr f32 WorldSize = 1000.0f;
+	static constexpr f32 QueryRadius = 8.0f;
+	static constexpr f32 MovementPerUpdate = 0.5f;
+	static constexpr ui32 QueriesToTest = 10000;
+
+	static f32 RandomCoordinate(f32 size)
+	{
+		return static_cast<f32>(rand()) / RAND_MAX * size;
+	}
+
+	static void Test(ui32 entitiesToTest)
+	{
+		Log->Info("", "Spatial index with %u entities\n", entitiesToTest);
+
+		EntityIDGenerator idGenerator;
+		vector<EntityID> ids(entitiesToTest);
+		vector<Vector3> positions(entitiesToTest);
+		for (ui32 index = 0; index < entitiesToTest; ++index)
+		{
+			ids[index] = idGenerator.Generate();
+			positions[index] = {RandomCoordinate(WorldSize), RandomCoordinate(WorldSize), RandomCoordinate(WorldSize)};
+		}
+
+		SpatialHashGrid grid;
+
+		auto before = TimeMoment::Now();
+		grid.Update(ToArray(ids), ToArray(positions));
+		auto after = TimeMoment::Now();
+		Log->Info("", "Inserting took %.2lfms\n", (after - before).ToSec_f64() * 1000);
+
+		for (auto &position : positions)
+		{
+			position += Vector3(RandomCoordinate(MovementPerUpdate), RandomCoordinate(MovementPerUpdate), RandomCoordinate(MovementPerUpdate));
+		}
+
+		before = TimeMoment::Now();
+		grid.Update(ToArray(ids), ToArray(positions));
+		after = TimeMoment::Now();
+		Log->Info("", "Updating all positions took %.2lfms\n", (after - before).ToSec_f64() * 1000);
+
+		vector<Vector3> centers(QueriesToTest);
+		for (auto &center : centers)
+		{
+			center = {RandomCoordinate(WorldSize), RandomCoordinate(WorldSize), RandomCoordinate(WorldSize)};
+		}
+
+		vector<EntityID> found;
+		vector<ui32> offsets;
+		before = TimeMoment::Now();
+		grid.QueryRadius(ToArray(centers), QueryRadius, found, offsets);
+		after = TimeMoment::Now();
+		Log->Info("", "%u radius queries took %.2lfms, found %zu entities\n", QueriesToTest, (after - before).ToSec_f64() * 1000, found.size());
+
+		before = TimeMoment::Now();
+		for (ui32 index = 0; index < entitiesToTest; index += 2)
+		{
+			grid.Remove(ids[index]);
+		}
+		after = TimeMoment::Now();
+		Log->Info("", "Removing half of the entities took %.2lfms\n\n", (after - before).ToSec_f64() * 1000);
+	}
+
+public:
+	SpatialBenchmarkClass()
+	{
+		Test(100'000);
+		Test(1'000'000);
+	}
+};
+
+void SpatialBenchmark()
+{
+    StdLib::Initialization::Initialize({});
+	SpatialBenchmarkClass test;
+}
@@ -134,6 +134,22 @@ namespace
 		shor2 = Archetype::Create<typeId, typeId, &typeId::first>(ToArray(types3));
 		ASSUME(shor == shor2);
 
+		// the hashes don't depend on the order of the types
+		TypeId types4[] = {ComponentArtist::GetTypeId(), ComponentGender::GetTypeId()};
+		TypeId types5[] = {ComponentGender::GetTypeId(), ComponentArtist::GetTypeId()};
+		ASSUME(Archetype::Create<TypeId>(ToArray(types4)) == Archetype::Create<TypeId>(ToArray(types5)));
+		ASSUME(Archetype::Create<TypeId>(ToArray(types4)) != shor);
+
+		// the ComponentIDs are combined with their types, so moving an ID to another type changes the archetype
+		typeId types6[] = {{ComponentArtist::GetTypeId(), ComponentID(0)}, {ComponentGender::GetTypeId(), ComponentID(1)}};
+		typeId types7[] = {{ComponentArtist::GetTypeId(), ComponentID(1)}, {ComponentGender::GetTypeId(), ComponentID(0)}};
+		typeId types8[] = {{ComponentGender::GetTypeId(), ComponentID(1)}, {ComponentArtist::GetTypeId(), ComponentID(0)}};
+		auto arc3 = ArchetypeFull::Create<typeId, typeId, &typeId::first, &typeId::second>(ToArray(types6));
+		auto arc4 = ArchetypeFull::Create<typeId, typeId, &typeId::first, &typeId::second>(ToArray(types7));
+		auto arc5 = ArchetypeFull::Create<typeId, typeId, &typeId::first, &typeId::second>(ToArray(types8));
+		ASSUME(arc3 != arc4);
+		ASSUME(arc3 == arc5);
+
 		if (!isSuppressLogs)
 		{
 			Log->Info("", "finished archetype tests\n");
@@ -272,8 +288,8 @@ namespace
 		req2 = Funcs::SortCompileTime(req2);
 
 		ArchetypeReflector reflector;
-		reflector.AddToLibrary(arch0, ToTypes(Funcs::SortCompileTime(ent0)));
-		reflector.AddToLibrary(arch1, ToTypes(Funcs::SortCompileTime(ent1)));
+		const auto &stored0 = reflector.AddToLibrary(arch0, ToTypes(Funcs::SortCompileTime(ent0)));
+		const auto &stored1 = reflector.AddToLibrary(arch1, ToTypes(Funcs::SortCompileTime(ent1)));
 		reflector.AddToLibrary(archEmpty, ToTypes(array<TypeId, 0>{}));
 
 		auto reflected = reflector.Reflect(arch0);
@@ -291,7 +307,7 @@ namespace
 
 		auto match = reflector.FindMatchingArchetypes(0);
 		ASSUME(match.size() == 1);
-		ASSUME(match[0] == arch0);
+		ASSUME(match[0] == &stored0);
 
 		match = reflector.FindMatchingArchetypes(1);
 		ASSUME(match.size() == 0);
@@ -299,14 +315,14 @@ namespace
 		match = reflector.FindMatchingArchetypes(2);
 		ASSUME(match.size() == 0);
 
-		reflector.AddToLibrary(arch2, ToTypes(Funcs::SortCompileTime(ent2)));
+		ASSUME(&reflector.AddToLibrary(arch2, ToTypes(Funcs::SortCompileTime(ent2))) == &stored1);
 		reflector.AddToLibrary(arch3, ToTypes(Funcs::SortCompileTime(ent3)));
 		reflector.AddToLibrary(arch4, ToTypes(Funcs::SortCompileTime(ent4)));
 		reflector.AddToLibrary(arch5, ToTypes(Funcs::SortCompileTime(ent5)));
 
 		match = reflector.FindMatchingArchetypes(0);
 		ASSUME(match.size() == 1);
-		ASSUME(match[0] == arch0);
+		ASSUME(match[0] == &stored0);
 
 		match = reflector.FindMatchingArchetypes(1);
 		ASSUME(match.size() == 0);
@@ -314,7 +330,7 @@ namespace
 		match = reflector.FindMatchingArchetypes(2);
 		ASSUME(match.size() == 2);
 		ASSUME(match[0] != match[1]);
-		ASSUME(match[0] == arch3 || match[0] == arch4);
+		ASSUME(match[0]->archetype == arch3 || match[0]->archetype == arch4);
 
 		reflected = reflector.Reflect(arch0);
 		ASSUME(IsReflectedEqual(reflected, ent0));
@@ -334,6 +350,30 @@ namespace
 		reflected = reflector.Reflect(arch5);
 		ASSUME(IsReflectedEqual(reflected, ent5));
 
+		// ad-hoc queries aren't tracked, but must match the same archetypes
+		vector<const ArchetypeReflector::StoredArchetype *> adHoc;
+		reflector.FindMatchingArchetypes(ToArray(ToRequired(req2)), adHoc);
+		ASSUME(adHoc.size() == 2);
+		ASSUME(std::find(adHoc.begin(), adHoc.end(), match[0]) != adHoc.end() && std::find(adHoc.begin(), adHoc.end(), match[1]) != adHoc.end());
+
+		auto masks = reflector.Compile(ToArray(ToRequired(req0)));
+		ASSUME(ArchetypeReflector::Satisfies(stored0, masks) && !ArchetypeReflector::Satisfies(stored1, masks));
+
+		// a group of alternatives, like RequiredComponentAny
+		ArchetypeDefiningRequirement anyOf[] =
+		{
+			{ComponentEmployee::GetTypeId(), 0, RequirementForComponent::Required},
+			{ComponentGender::GetTypeId(), 0, RequirementForComponent::Required},
+			{ComponentCompany::GetTypeId(), 1, RequirementForComponent::Subtractive}
+		};
+		adHoc.clear();
+		reflector.FindMatchingArchetypes(ToArray(anyOf), adHoc);
+		ASSUME(adHoc.size() == 2);
+		for (const ArchetypeReflector::StoredArchetype *archetype : adHoc)
+		{
+			ASSUME(ArchetypeReflector::Satisfies(ToArray(archetype->types), ToArray(anyOf)));
+		}
+
 		if (!isSuppressLogs)
 		{
 			Log->Info("", "finished archetype reflector tests\n");
@@ -364,6 +404,12 @@ namespace
 		{}
 	};
 
+	struct TestSystem5 : DirectSystem<TestSystem5>
+	{
+		void Accept(Changed<ComponentSpouse, ComponentGender>, Array<ComponentSpouse> &, const Array<EntityID> &, Environment &)
+		{}
+	};
+
 	template <typename... Types> constexpr array<TypeId, sizeof...(Types)> MakeArray()
 	{
 		return {Types::GetTypeId()...};
@@ -503,8 +549,476 @@ namespace
 		static_assert(testArchetypeDefining(testSystem4Requests.archetypeDefiningInfoOnly, MakeArray<ComponentSpouse, ComponentCompany>(), make_array(TypeAndGroup{ComponentEmployee::GetTypeId(), 0}, TypeAndGroup{ComponentGender::GetTypeId(), 0})));
 		static_assert(testSystem4Requests.entityIDIndex == nullopt);
 		static_assert(testSystem4Requests.environmentIndex == nullopt);
+		static_assert(testSystem4Requests.changed.size() == 0);
+
+		constexpr auto testSystem5RequestsTuple = TestSystem5::AcquireRequestedComponents();
+		constexpr auto testSystem5Requests = _SystemAuxFuncs::ComponentsTupleToRequests(testSystem5RequestsTuple);
+
+		// Changed only filters the groups, it doesn't add any requirements
+		static_assert(matches(testSystem5Requests.all, MakeArray<ComponentSpouse>()));
+		static_assert(matches(testSystem5Requests.argumentPassingOrder, MakeArray<ComponentSpouse>(), false));
+		static_assert(testSystem5Requests.changed.size() == 2 && testSystem5Requests.changed[0] == ComponentSpouse::GetTypeId() && testSystem5Requests.changed[1] == ComponentGender::GetTypeId());
+		static_assert(testSystem5Requests.entityIDIndex == 1);
+		static_assert(testSystem5Requests.environmentIndex == 2);
 #endif
 	}
+
+	template <ui32 Index> struct ControlsLogTestSystem : IndirectSystem<ControlsLogTestSystem<Index>>
+	{
+		void Accept(const Array<ComponentFirstName> &) {}
+
+		virtual void Update(System::Environment &env) override
+		{
+		}
+	};
+
+	struct ChangedWriterSystem : DirectSystem<ChangedWriterSystem>
+	{
+		void Accept(Array<ComponentDateOfBirth> &dates, RequiredComponent<TagTest0>)
+		{
+			for (auto &date : dates)
+			{
+				++date.dateOfBirth;
+			}
+		}
+	};
+
+	struct ChangedReaderSystem : DirectSystem<ChangedReaderSystem>
+	{
+		vector<EntityID> passed{};
+
+		void Accept(Changed<ComponentDateOfBirth>, const Array<ComponentDateOfBirth> &, const Array<EntityID> &ids)
+		{
+			passed.insert(passed.end(), ids.begin(), ids.end());
+		}
+	};
+
+	struct ReactiveDriverSystem : IndirectSystem<ReactiveDriverSystem>
+	{
+		vector<EntityID> datesToChange{}, namesToChange{}, entitiesToRemove{};
+		bool isSendingControl = false;
+
+		void Accept(Array<ComponentDateOfBirth> &, Array<ComponentFirstName> &) {}
+
+		virtual void Update(Environment &env) override
+		{
+			for (EntityID id : datesToChange)
+			{
+				ComponentDateOfBirth date;
+				date.dateOfBirth = 1;
+				env.messageBuilder.ComponentChanged(id, date);
+			}
+			for (EntityID id : namesToChange)
+			{
+				ComponentFirstName name;
+				name.name.fill('r');
+				env.messageBuilder.ComponentChanged(id, name);
+			}
+			for (EntityID id : entitiesToRemove)
+			{
+				env.messageBuilder.RemoveEntity(id);
+			}
+			if (isSendingControl)
+			{
+				env.keyController->Dispatch(ControlAction(ControlAction::MouseWheel{1}, {}, DeviceTypes::MouseKeyboard));
+			}
+
+			datesToChange.clear();
+			namesToChange.clear();
+			entitiesToRemove.clear();
+			isSendingControl = false;
+		}
+	};
+
+	struct ReactiveDateSystem : DirectSystem<ReactiveDateSystem>
+	{
+		void Accept(const Array<ComponentDateOfBirth> &) {}
+
+		virtual bool IsReactive() const override
+		{
+			return true;
+		}
+	};
+
+	struct ParallelVisitSystem : ForEachSystem<ParallelVisitSystem, true>
+	{
+		std::atomic<ui32> *visits{}; // indexed by dateOfBirth
+
+		void Update(const ComponentDateOfBirth &date)
+		{
+			++visits[date.dateOfBirth];
+		}
+	};
+
+	struct ChangedRecorderSystem : IndirectSystem<ChangedRecorderSystem>
+	{
+		void Accept(const Array<ComponentDateOfBirth> &) {}
+
+		virtual void Update(Environment &env) override
+		{
+		}
+	};
+
+	struct AddedOnlySystem : IndirectSystem<AddedOnlySystem>
+	{
+		void Accept(const Array<ComponentDateOfBirth> &) {}
+
+		virtual void Update(Environment &env) override
+		{
+		}
+
+		virtual MessageTypes::MessageType AcceptedMessageTypes() const override
+		{
+			return MessageTypes::ComponentAdded;
+		}
+	};
+
+	struct LatestStateSystem : IndirectSystem<LatestStateSystem>
+	{
+		vector<pair<EntityID, ui32>> seen{};
+
+		void Accept(const Array<ComponentDateOfBirth> &) {}
+
+		virtual void ProcessMessages(Environment &env, const MessageStreamComponentChanged &stream) override
+		{
+			for (auto [date, id] : stream.Enumerate<ComponentDateOfBirth>())
+			{
+				seen.emplace_back(id, date.dateOfBirth);
+			}
+		}
+
+		virtual void Update(Environment &env) override
+		{
+		}
+
+		virtual MessageTypes::MessageType AcceptedMessageTypes() const override
+		{
+			return MessageTypes::ComponentChanged;
+		}
+
+		virtual ComponentChangedPolicy ComponentChangedMessagesPolicy() const override
+		{
+			return ComponentChangedPolicy::LatestState;
+		}
+	};
+
+	struct ChangedSenderSystem : IndirectSystem<ChangedSenderSystem>
+	{
+		vector<EntityID> ids{}; // the changes are sent once, the dates become 1000 + index
+
+		void Accept(Array<ComponentDateOfBirth> &) {}
+
+		virtual void Update(Environment &env) override
+		{
+			for (uiw index = 0; index < ids.size(); ++index)
+			{
+				ComponentDateOfBirth date;
+				date.dateOfBirth = 1000 + static_cast<ui32>(index);
+				env.messageBuilder.ComponentChanged(ids[index], date);
+			}
+			ids.clear();
+		}
+	};
+
+	struct NestedQuerySystem : IndirectSystem<NestedQuerySystem>
+	{
+		std::atomic<ui32> outerSeen{}, innerSeen{}; // entities visited by the last update
+
+		void Accept(const Array<ComponentDateOfBirth> &) {}
+
+		virtual void Update(Environment &env) override
+		{
+			ui32 outer = 0, inner = 0;
+			env.directQuery->ForEach([&env, &outer, &inner](const Array<ComponentDateOfBirth> &dates)
+			{
+				env.directQuery->ForEach([&inner](const Array<ComponentFirstName> &names)
+				{
+					inner += static_cast<ui32>(names.size());
+				});
+				outer += static_cast<ui32>(dates.size()); // read after the nested query to ensure it didn't overwrite the arguments
+			});
+			outerSeen = outer;
+			innerSeen = inner;
+		}
+	};
+
+	static void SpatialHashGridTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		SpatialHashGrid grid(2.0f);
+		vector<EntityID> ids;
+		vector<Vector3> positions;
+		for (ui32 index = 0; index < 500; ++index)
+		{
+			ids.push_back(gen.Generate());
+			positions.push_back({static_cast<f32>(rand() % 41) - 20, static_cast<f32>(rand() % 41) - 20, static_cast<f32>(rand() % 41) - 20});
+		}
+		grid.Update(ToArray(ids), ToArray(positions));
+		ASSUME(grid.Size() == ids.size());
+
+		// move some of the entities across the cells and remove some others
+		for (uiw index = 0; index < ids.size(); index += 3)
+		{
+			positions[index] += Vector3(3.5f, -1.0f, 0.25f);
+			grid.Update(ids[index], positions[index]);
+		}
+		for (uiw index = 1; index < ids.size(); index += 7)
+		{
+			grid.Remove(ids[index]);
+		}
+		grid.Remove(ids[1]); // removing twice does nothing
+		ASSUME(grid.Find(ids[1]) == nullopt);
+
+		auto isStored = [](uiw index) { return (index % 7) != 1; };
+
+		vector<Vector3> centers = {{0, 0, 0}, {-20, 20, -20}, {5.5f, -3.25f, 11}, {100, 100, 100}};
+		vector<EntityID> found;
+		vector<ui32> offsets;
+		grid.QueryRadius(ToArray(centers), 6.0f, found, offsets);
+		ASSUME(offsets.size() == centers.size() + 1);
+
+		// compare with the brute force
+		for (uiw centerIndex = 0; centerIndex < centers.size(); ++centerIndex)
+		{
+			vector<EntityID> expected;
+			for (uiw index = 0; index < ids.size(); ++index)
+			{
+				Vector3 delta = positions[index] - centers[centerIndex];
+				if (isStored(index) && delta.x * delta.x + delta.y * delta.y + delta.z * delta.z <= 6.0f * 6.0f)
+				{
+					expected.push_back(ids[index]);
+				}
+			}
+
+			vector<EntityID> actual(found.begin() + offsets[centerIndex], found.begin() + offsets[centerIndex + 1]);
+			auto byHint = [](EntityID left, EntityID right) { return left.Hint() < right.Hint(); };
+			std::sort(expected.begin(), expected.end(), byHint);
+			std::sort(actual.begin(), actual.end(), byHint);
+			ASSUME(expected == actual);
+		}
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished spatial hash grid tests\n");
+		}
+	}
+
+	static void TransformHierarchyTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		EntityID a = gen.Generate(), b = gen.Generate(), c = gen.Generate(), d = gen.Generate(), e = gen.Generate(), f = gen.Generate();
+
+		// a <- b <- c and d are placed, e and f are each other's parents, b doesn't write its world matrix
+		TransformHierarchy hierarchy;
+		hierarchy.Assign(a, {1, 0, 0}, {}, {1, 1, 1}, {}, true);
+		hierarchy.Assign(b, {0, 2, 0}, {}, {1, 1, 1}, a, false);
+		hierarchy.Assign(c, {0, 0, 3}, {}, {1, 1, 1}, b, true);
+		hierarchy.Assign(d, {5, 0, 0}, {}, {1, 1, 1}, {}, true);
+		hierarchy.Assign(e, {}, {}, {1, 1, 1}, f, false);
+		hierarchy.Assign(f, {}, {}, {1, 1, 1}, e, false);
+
+		vector<EntityID> changedIds;
+		vector<Matrix4x3> changedWorlds;
+		auto isChanged = [&changedIds](std::initializer_list<EntityID> expected)
+		{
+			return changedIds.size() == expected.size() && std::all_of(expected.begin(), expected.end(), [&changedIds](EntityID id) { return std::find(changedIds.begin(), changedIds.end(), id) != changedIds.end(); });
+		};
+		auto isAt = [&hierarchy](EntityID id, f32 x, f32 y, f32 z)
+		{
+			Vector3 position = hierarchy.FindWorld(id)->GetRow(3);
+			return position.x == x && position.y == y && position.z == z;
+		};
+		auto update = [&]
+		{
+			changedIds.clear();
+			changedWorlds.clear();
+			hierarchy.Update(changedIds, changedWorlds);
+			ASSUME(changedIds.size() == changedWorlds.size());
+		};
+
+		update();
+		ASSUME(hierarchy.Size() == 6);
+		ASSUME(hierarchy.LevelsCount() == 3);
+		ASSUME(hierarchy.FindDepth(a) == 0 && hierarchy.FindDepth(d) == 0 && hierarchy.FindDepth(b) == 1 && hierarchy.FindDepth(c) == 2);
+		ASSUME(hierarchy.IgnoredCount() == 2);
+		ASSUME(hierarchy.FindDepth(e) == nullopt && hierarchy.FindWorld(f) == nullopt);
+		ASSUME(isChanged({a, c, d}));
+		ASSUME(isAt(b, 1, 2, 0) && isAt(c, 1, 2, 3) && isAt(d, 5, 0, 0));
+
+		// nothing changed, nothing is reported
+		update();
+		ASSUME(changedIds.empty());
+
+		// the dirty parent propagates to the whole subtree
+		hierarchy.SetPosition(a, {10, 0, 0});
+		update();
+		ASSUME(isChanged({a, c}));
+		ASSUME(isAt(b, 10, 2, 0) && isAt(c, 10, 2, 3) && isAt(d, 5, 0, 0));
+
+		// a dirty leaf doesn't touch its parents
+		hierarchy.SetPosition(c, {0, 0, 4});
+		hierarchy.SetPosition(gen.Generate(), {1, 1, 1}); // isn't stored, ignored
+		update();
+		ASSUME(isChanged({c}));
+		ASSUME(isAt(c, 10, 2, 4));
+		ASSUME(hierarchy.Size() == 6);
+
+		// reparenting rebuilds the levels
+		hierarchy.SetParent(c, d);
+		update();
+		ASSUME(hierarchy.LevelsCount() == 2);
+		ASSUME(hierarchy.FindDepth(c) == 1);
+		ASSUME(isAt(c, 5, 0, 4));
+
+		// breaking the cycle places its entities
+		hierarchy.SetParent(e, {});
+		update();
+		ASSUME(hierarchy.IgnoredCount() == 0);
+		ASSUME(hierarchy.FindDepth(e) == 0 && hierarchy.FindDepth(f) == 1);
+		ASSUME(isChanged({a, c, d}));
+
+		// the removed entity's children become roots
+		hierarchy.Remove(a);
+		hierarchy.SetWritingWorld(b, true);
+		update();
+		ASSUME(hierarchy.Size() == 5);
+		ASSUME(hierarchy.FindDepth(a) == nullopt && hierarchy.FindDepth(b) == 0);
+		ASSUME(isAt(b, 0, 2, 0));
+		ASSUME(isChanged({b, c, d}));
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished transform hierarchy tests\n");
+		}
+	}
+
+	static void ParallelForEachTests(bool isSuppressLogs)
+	{
+		// two groups are split between the threads, the last one is smaller than a single chunk
+		constexpr ui32 groupSizes[] = {5000, 3000, 10};
+		constexpr ui32 total = groupSizes[0] + groupSizes[1] + groupSizes[2];
+		auto visits = make_unique<std::atomic<ui32>[]>(total);
+
+		EntityIDGenerator idGenerator;
+		auto stream = make_unique<EntitiesStream>();
+		ui32 date = 0;
+		for (uiw group = 0; group < CountOf(groupSizes); ++group)
+		{
+			for (ui32 index = 0; index < groupSizes[group]; ++index)
+			{
+				EntitiesStream::EntityData entity;
+				ComponentDateOfBirth component;
+				component.dateOfBirth = date++;
+				entity.AddComponent(component);
+				if (group == 1)
+				{
+					entity.AddComponent(TagTest0{});
+				}
+				else if (group == 2)
+				{
+					entity.AddComponent(TagTest1{});
+				}
+				stream->AddEntity(idGenerator.Generate(), move(entity));
+			}
+		}
+
+		auto manager = SystemsManager::New(false, Log);
+		auto pipeline = manager->CreatePipeline(nullopt, false);
+		auto system = make_unique<ParallelVisitSystem>();
+		system->visits = visits.get();
+		manager->Register(move(system), pipeline);
+
+		vector<WorkerThread> workers(3);
+		vector<unique_ptr<IEntitiesStream>> streams;
+		streams.push_back(move(stream));
+		manager->Start({}, move(idGenerator), move(workers), move(streams));
+		while (manager->GetPipelineInfo(pipeline).executedTimes < 5)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		manager->Pause(true);
+
+		// every row is visited exactly once per frame
+		ui32 frames = manager->GetPipelineInfo(pipeline).executedTimes;
+		for (ui32 index = 0; index < total; ++index)
+		{
+			ASSUME(visits[index] == frames);
+		}
+
+		manager->Stop(true);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished parallel for each tests\n");
+		}
+	}
+
+	static void ControlsRingTests(bool isSuppressLogs)
+	{
+		ControlsRing dropping(3, ControlsRing::FullPolicy::DropNewest);
+		ASSUME(dropping.Capacity() == 4);
+		for (i32 index = 0; index < 6; ++index)
+		{
+			bool isPushed = dropping.Push(ControlAction(ControlAction::MouseWheel{index}, {}, DeviceTypes::MouseKeyboard));
+			ASSUME(isPushed == (index < 4));
+		}
+		ASSUME(dropping.DroppedCount() == 2);
+
+		ControlAction action;
+		for (i32 index = 0; index < 4; ++index)
+		{
+			bool isPopped = dropping.TryPop(action);
+			ASSUME(isPopped && action.Get<ControlAction::MouseWheel>()->delta == index);
+		}
+		bool isPopped = dropping.TryPop(action);
+		ASSUME(isPopped == false);
+
+		// synthetic producers, the consumer pops while they're pushing, the ring is much smaller than the total
+		constexpr i32 producersCount = 4, actionsPerProducer = 20000;
+		ControlsRing waiting(64, ControlsRing::FullPolicy::Wait);
+		TimeMoment occuredAt = TimeMoment::Now();
+
+		vector<std::thread> producers;
+		for (i32 producer = 0; producer < producersCount; ++producer)
+		{
+			producers.emplace_back([&waiting, occuredAt, producer]
+			{
+				for (i32 index = 0; index < actionsPerProducer; ++index)
+				{
+					waiting.Push(ControlAction(ControlAction::MouseMove{{producer, index}}, occuredAt, DeviceTypes::MouseKeyboard));
+				}
+			});
+		}
+
+		vector<i32> nextIndexes(producersCount, 0);
+		for (i32 received = 0; received < producersCount * actionsPerProducer; )
+		{
+			if (waiting.TryPop(action) == false)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// the actions of each producer arrive in the order they were pushed
+			auto *move = action.Get<ControlAction::MouseMove>();
+			ASSUME(move && move->delta.y == nextIndexes[move->delta.x]);
+			ASSUME(action.occuredAt == occuredAt && action.device == DeviceTypes::MouseKeyboard);
+			++nextIndexes[move->delta.x];
+			++received;
+		}
+
+		for (auto &producer : producers)
+		{
+			producer.join();
+		}
+		isPopped = waiting.TryPop(action);
+		ASSUME(isPopped == false && waiting.DroppedCount() == 0);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished controls ring tests\n");
+		}
+	}
 }
 
 class UnitTests
@@ -530,6 +1044,8 @@ public:
 			return name;
 		};
 
+		auto changedCursor = builder.ComponentChangedStream<ComponentFirstName>();
+
 		for (ui32 index = 0; index < 1000; ++index)
 		{
 			EntityID entityId = gen.Generate();
@@ -563,7 +1079,14 @@ public:
 			{
 				ComponentFirstName changed = generateName();
 
-				builder.ComponentChanged(entityId, changed);
+				if (rand() % 2)
+				{
+					builder.ComponentChanged(entityId, changed);
+				}
+				else
+				{
+					changedCursor.ComponentChanged(entityId, changed);
+				}
 
 				entityAfterChangeNames[entityId] = changed;
 			}
@@ -626,6 +1149,8 @@ public:
 		}
 		ASSUME(checked == entitiesRemoved.size());
 
+		ASSUME(builder.ComponentChangedStreams()._data.size() == 1);
+
 		checked = 0;
 		for (const auto &[type, streamSource] : builder.ComponentChangedStreams()._data)
 		{
@@ -640,11 +1165,1061 @@ public:
 		}
 		ASSUME(checked == entityAfterChangeNames.size());
 
+		vector<EntityID> viewIds;
+		vector<ComponentFirstName> viewNames;
+		for (const auto &[id, name] : entityAfterChangeNames)
+		{
+			viewIds.push_back(id);
+			viewNames.push_back(name);
+		}
+
+		ComponentDescription viewDesc;
+		viewDesc.type = ComponentFirstName::GetTypeId();
+		viewDesc.sizeOf = sizeof(ComponentFirstName);
+		viewDesc.alignmentOf = alignof(ComponentFirstName);
+		viewDesc.isUnique = true;
+		auto viewInfo = builder.ComponentChangedView(viewDesc, ToArray(viewIds), reinterpret_cast<const byte *>(viewNames.data()));
+		ASSUME(viewInfo->IsView());
+
+		auto checkView = [&entityAfterChangeNames, &viewInfo, &viewDesc]
+		{
+			MessageStreamComponentChanged changed({}, viewInfo, viewDesc, "MessageBuilderTests");
+
+			ui32 checked = 0;
+			for (auto component : changed.Enumerate<ComponentFirstName>())
+			{
+				++checked;
+				ASSUME(!MemOps::Compare(entityAfterChangeNames[component.entityID].name.data(), component.component.name.data(), component.component.name.size()));
+			}
+			ASSUME(checked == entityAfterChangeNames.size());
+		};
+
+		checkView();
+		viewInfo->Detach(viewDesc);
+		ASSUME(viewInfo->IsView() == false);
+		for (auto &name : viewNames)
+		{
+			name = generateName();
+		}
+		checkView();
+
 		if (!isSuppressLogs)
 		{
 			Log->Info("", "finished message builder tests\n");
 		}
 	}
+
+	static void MessageBuilderPoolingTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&gen);
+
+		auto addEntities = [&builder, &gen](char letter)
+		{
+			for (ui32 index = 0; index < 100; ++index)
+			{
+				ComponentFirstName name;
+				name.name.fill(letter);
+				ComponentArtist artist;
+				artist.area = ComponentArtist::Areas::Concept;
+				builder.AddEntity(gen.Generate()).AddComponent(name).AddComponent(artist);
+			}
+		};
+
+		auto checkEntities = [](const MessageStreamRegisterEntity &stream, char letter)
+		{
+			ui32 checked = 0;
+			for (const auto &entity : stream)
+			{
+				const auto &name = entity.GetComponent<ComponentFirstName>();
+				ASSUME(std::all_of(name.name.begin(), name.name.end(), [letter](char c) { return c == letter; }));
+				++checked;
+			}
+			ASSUME(checked == 100);
+		};
+
+		// a stream that is still referenced after Clear must keep its payloads
+		addEntities('a');
+		ASSUME(builder.EntityAddedStreams()._data.size() == 1);
+		optional<MessageStreamRegisterEntity> held;
+		{
+			const auto &[archetype, source] = builder.EntityAddedStreams()._data.front();
+			held = MessageStreamRegisterEntity(archetype, source, "MessageBuilderPoolingTests");
+		}
+		builder.Clear();
+
+		addEntities('b');
+		checkEntities(*held, 'a');
+		ASSUME(builder._arenas.size() == 2);
+		builder.Clear();
+
+		// once the stream is released, its arena and stream object get reused
+		held.reset();
+		for (ui32 iteration = 0; iteration < 10; ++iteration)
+		{
+			addEntities('c');
+			ASSUME(builder.EntityAddedStreams()._data.size() == 1);
+			const auto &[archetypeC, sourceC] = builder.EntityAddedStreams()._data.front();
+			checkEntities(MessageStreamRegisterEntity(archetypeC, sourceC, "MessageBuilderPoolingTests"), 'c');
+			builder.Clear();
+		}
+		ASSUME(builder._arenas.size() == 2);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished message builder pooling tests\n");
+		}
+	}
+
+	static void MessageBuilderCoalescingTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&gen);
+
+		EntityID changedThrice = gen.Generate(), removedEntity = gen.Generate(), removedComponent = gen.Generate(), addedToRemoved = gen.Generate(), changedTwice = gen.Generate();
+		TypeId types[] = {ComponentFirstName::GetTypeId()};
+		Archetype archetype = Archetype::Create<TypeId>(ToArray(types));
+
+		auto name = [](char letter)
+		{
+			ComponentFirstName component;
+			component.name.fill(letter);
+			return component;
+		};
+
+		auto cursor = builder.ComponentChangedStream<ComponentFirstName>();
+		builder.ComponentChanged(changedThrice, name('a'));
+		cursor.ComponentChanged(removedEntity, name('a'));
+		builder.ComponentChanged(removedComponent, name('a'));
+		cursor.ComponentChanged(changedTwice, name('d'));
+		cursor.ComponentChanged(changedThrice, name('b'));
+		builder.ComponentChanged(changedThrice, name('c'));
+		builder.ComponentChanged(changedTwice, name('e'));
+
+		builder.RemoveEntity(removedEntity, archetype);
+		builder.RemoveEntity(removedEntity, archetype);
+		builder.RemoveComponent(removedComponent, ComponentFirstName{});
+		builder.RemoveComponent(removedComponent, ComponentFirstName{});
+
+		builder.AddComponent(addedToRemoved, TagTest0{});
+		builder.RemoveEntity(addedToRemoved, archetype);
+
+		builder.Coalesce();
+
+		ASSUME(builder.ComponentAddedStreams()._data.empty());
+
+		ASSUME(builder.ComponentRemovedStreams()._data.size() == 1);
+		ASSUME(builder.ComponentRemovedStreams()._data.front().second->entityIds.size() == 1);
+
+		ASSUME(builder.EntityRemovedStreams()._data.size() == 1);
+		ASSUME(builder.EntityRemovedStreams()._data.front().second->size() == 2);
+
+		ASSUME(builder.ComponentChangedStreams()._data.size() == 1);
+		const auto &[type, streamSource] = builder.ComponentChangedStreams()._data.front();
+		MessageStreamComponentChanged changed({}, streamSource.second, streamSource.first, "MessageBuilderCoalescingTests");
+
+		pair<EntityID, char> expected[] = {{changedThrice, 'c'}, {changedTwice, 'e'}};
+		ui32 checked = 0;
+		for (auto component : changed.Enumerate<ComponentFirstName>())
+		{
+			ASSUME(checked < CountOf(expected));
+			ASSUME(component.entityID == expected[checked].first);
+			ASSUME(component.component.name[0] == expected[checked].second);
+			++checked;
+		}
+		ASSUME(checked == CountOf(expected));
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished message builder coalescing tests\n");
+		}
+	}
+
+	static void MessageBuilderRangeTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&gen);
+
+		vector<EntityID> ids;
+		vector<ComponentFirstName> names;
+		for (ui32 index = 0; index < 100; ++index)
+		{
+			ids.push_back(gen.Generate());
+			names.emplace_back();
+			names.back().name.fill('a' + index % 26);
+		}
+
+		// the first half is copied, the second half is written in place
+		builder.ComponentChangedRange<ComponentFirstName>(Array<const EntityID>(ids.data(), 50), Array<const ComponentFirstName>(names.data(), 50));
+		auto reserved = builder.ComponentChangedReserve<ComponentFirstName>(Array<const EntityID>(ids.data() + 50, 50));
+		ASSUME(reserved.size() == 50);
+		for (uiw index = 0; index < reserved.size(); ++index)
+		{
+			reserved[index] = names[50 + index];
+		}
+
+		ASSUME(builder.ComponentChangedStreams()._data.size() == 1);
+		const auto &[type, streamSource] = builder.ComponentChangedStreams()._data.front();
+		MessageStreamComponentChanged changed({}, streamSource.second, streamSource.first, "MessageBuilderRangeTests");
+
+		uiw checked = 0;
+		for (auto component : changed.Enumerate<ComponentFirstName>())
+		{
+			ASSUME(component.entityID == ids[checked]);
+			ASSUME(!MemOps::Compare(component.component.name.data(), names[checked].name.data(), names[checked].name.size()));
+			++checked;
+		}
+		ASSUME(checked == ids.size());
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished message builder range tests\n");
+		}
+	}
+
+	static void MessageBuilderSpawnBatchTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&gen);
+
+		vector<ComponentFirstName> names(100);
+		for (uiw index = 0; index < names.size(); ++index)
+		{
+			names[index].name.fill('a' + index % 26);
+		}
+
+		SerializedComponent columns[2];
+		static_cast<ComponentDescription &>(columns[0]) = ComponentFirstName::Description();
+		columns[0].data = reinterpret_cast<const byte *>(names.data());
+		static_cast<ComponentDescription &>(columns[1]) = TagTest0::Description();
+
+		auto ids = builder.SpawnBatch(ToArray(columns), names.size());
+		ASSUME(ids.size() == names.size());
+		for (uiw index = 1; index < ids.size(); ++index)
+		{
+			ASSUME(ids[index].Hint() == ids[index - 1].Hint() + 1);
+		}
+		ASSUME(gen.Generate().Hint() == ids[ids.size() - 1].Hint() + 1);
+
+		names.assign(names.size(), ComponentFirstName{}); // the batch must've copied the source data
+
+		ASSUME(builder._entitiesBatches.size() == 1);
+		auto stream = builder.EntitiesBatchToStream(builder._entitiesBatches.front());
+		ASSUME(stream->size() == ids.size());
+		for (uiw index = 0; index < stream->size(); ++index)
+		{
+			const auto &entry = (*stream)[index];
+			ASSUME(entry.entityID == ids[index] && entry.components.size() == 2);
+			const auto &name = *reinterpret_cast<const ComponentFirstName *>(entry.components[0].data);
+			ASSUME(name.name[0] == 'a' + index % 26);
+			ASSUME(entry.components[1].isTag);
+		}
+
+		builder.Clear();
+		ASSUME(builder.IsEmpty());
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished message builder spawn batch tests\n");
+		}
+	}
+
+	static void MessageBuilderPrefabTests(bool isSuppressLogs)
+	{
+		EntityIDGenerator gen;
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&gen);
+
+		ComponentFirstName name;
+		name.name.fill('p');
+		ComponentArrayBuilder components;
+		components.AddComponent(name).AddComponent(TagTest0{});
+		Prefab prefab(components.GetComponents());
+		components.Clear();
+
+		auto instances = builder.Instantiate(prefab, 37, "prefab instance");
+		ASSUME(instances.EntityIDs().size() == 37);
+		auto names = instances.Column<ComponentFirstName>();
+		ASSUME(names.size() == 37);
+		for (const auto &instance : names)
+		{
+			ASSUME(!MemOps::Compare(instance.name.data(), name.name.data(), name.name.size()));
+		}
+		names[5].name.fill('o'); // overrides only the sixth instance
+
+		ASSUME(builder._entitiesBatches.size() == 1 && builder._entitiesBatches.front().archetype == prefab.GetArchetype());
+		auto stream = builder.EntitiesBatchToStream(builder._entitiesBatches.front());
+		for (uiw index = 0; index < stream->size(); ++index)
+		{
+			const auto &entry = (*stream)[index];
+			ASSUME(entry.entityID == instances.EntityIDs()[index]);
+			#ifdef DEBUG
+				ASSUME(!strcmp(entry.entityID.DebugName().data(), "prefab instance"));
+			#endif
+			auto it = std::find_if(entry.components.begin(), entry.components.end(), [](const SerializedComponent &sc) { return sc.type == ComponentFirstName::GetTypeId(); });
+			ASSUME(it != entry.components.end() && it->Cast<ComponentFirstName>().name[0] == (index == 5 ? 'o' : 'p'));
+		}
+
+		builder.Clear();
+
+		// non-unique components, the instances are added as separate entities, their ComponentIDs are assigned on registration
+		ComponentArtist artist;
+		artist.area = ComponentArtist::Areas::Concept;
+		components.AddComponent(name).AddComponent(artist).AddComponent(artist);
+		Prefab nonUniquePrefab(components.GetComponents());
+
+		auto nonUniqueInstances = builder.Instantiate(nonUniquePrefab, 5);
+		nonUniqueInstances.Column<ComponentFirstName>()[3].name.fill('o');
+		ASSUME(builder._entitiesBatches.empty());
+		ASSUME(builder.EntityAddedStreams()._data.size() == 1);
+		const auto &[archetype, entities] = builder.EntityAddedStreams()._data.front();
+		ASSUME(archetype == nonUniquePrefab.GetArchetype() && entities->size() == 5);
+		for (uiw index = 0; index < entities->size(); ++index)
+		{
+			const auto &entry = (*entities)[index];
+			ASSUME(entry.entityID == nonUniqueInstances.EntityIDs()[index] && entry.components.size() == 3);
+			#ifdef DEBUG
+				ASSUME(entry.entityID.DebugName().size() == 0); // isn't named by default
+			#endif
+			uiw artists = 0;
+			for (const auto &component : entry.components)
+			{
+				if (auto *instanceArtist = component.TryCast<ComponentArtist>(); instanceArtist)
+				{
+					ASSUME(instanceArtist->area == ComponentArtist::Areas::Concept && component.id.IsValid() == false);
+					++artists;
+				}
+				else
+				{
+					ASSUME(component.Cast<ComponentFirstName>().name[0] == (index == 3 ? 'o' : 'p'));
+				}
+			}
+			ASSUME(artists == 2);
+		}
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished message builder prefab tests\n");
+		}
+	}
+
+	static void ControlsLogTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		auto pipeline = manager->CreatePipeline(nullopt, false);
+
+		array<ui32, 4> received{};
+		vector<IKeyController::ListenerHandle> listeners;
+		auto registerSystem = [&](unique_ptr<System> system, uiw index, bool isWithKeyController)
+		{
+			if (isWithKeyController)
+			{
+				auto keyController = KeyController::New();
+				listeners.push_back(keyController->OnControlAction([&received, index](const ControlAction &) { ++received[index]; }));
+				system->SetKeyController(keyController);
+			}
+			manager->Register(move(system), pipeline);
+		};
+		registerSystem(make_unique<ControlsLogTestSystem<0>>(), 0, true);
+		registerSystem(make_unique<ControlsLogTestSystem<1>>(), 1, true);
+		registerSystem(make_unique<ControlsLogTestSystem<2>>(), 2, false);
+
+		ControlAction action(ControlAction::MouseWheel{1}, {}, DeviceTypes::MouseKeyboard);
+		auto &systems = manager->_pipelines.front().indirectSystems;
+		manager->_controlsLog.push_back({action, systems[0].system.get()});
+		manager->_controlsLog.push_back({action, nullptr});
+
+		// the actions sent before the registration are not delivered to the new system
+		registerSystem(make_unique<ControlsLogTestSystem<3>>(), 3, true);
+		ASSUME(systems[0].controlsCursor == 0 && systems[1].controlsCursor == 0 && systems[3].controlsCursor == 2);
+		ASSUME(manager->IsControlsLogPending(*systems[3].system, systems[3].controlsCursor) == false);
+
+		// a system doesn't receive its own actions
+		ASSUME(manager->IsControlsLogPending(*systems[0].system, systems[0].controlsCursor));
+		manager->ProcessControlsLog(*systems[0].system, systems[0].controlsCursor);
+		manager->ProcessControlsLog(*systems[1].system, systems[1].controlsCursor);
+		ASSUME(received[0] == 1 && received[1] == 2 && received[3] == 0);
+		ASSUME(systems[0].controlsCursor == 2 && systems[1].controlsCursor == 2);
+
+		// the system without a key controller never reads the log, so it doesn't hold the trimming back
+		ASSUME(manager->IsControlsLogPending(*systems[2].system, systems[2].controlsCursor) == false);
+		manager->TrimControlsLog();
+		ASSUME(manager->_controlsLog.empty() && manager->_controlsLogStart == 2);
+
+		manager->_controlsLog.push_back({action, systems[1].system.get()});
+		ASSUME(manager->IsControlsLogPending(*systems[1].system, systems[1].controlsCursor) == false);
+		manager->ProcessControlsLog(*systems[1].system, systems[1].controlsCursor);
+		ASSUME(received[1] == 2 && systems[1].controlsCursor == 3);
+		manager->TrimControlsLog();
+		ASSUME(manager->_controlsLog.size() == 1 && manager->_controlsLogStart == 2); // the other systems haven't read it yet
+
+		manager->ProcessControlsLog(*systems[0].system, systems[0].controlsCursor);
+		manager->ProcessControlsLog(*systems[3].system, systems[3].controlsCursor);
+		ASSUME(received[0] == 2 && received[3] == 1);
+		manager->TrimControlsLog();
+		ASSUME(manager->_controlsLog.empty() && manager->_controlsLogStart == 3);
+
+		manager->Unregister(systems[1].system->GetTypeId());
+		ASSUME(systems.size() == 3);
+
+		manager->_controlsLog.push_back({action, nullptr});
+		manager->Stop(false);
+		ASSUME(manager->_controlsLog.empty() && manager->_controlsLogStart == 0);
+		for (const auto &managed : systems)
+		{
+			ASSUME(managed.controlsCursor == 0);
+		}
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished controls log tests\n");
+		}
+	}
+
+	static void MatchingCommandsTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+
+		auto addEntity = [&builder](char letter, auto... components)
+		{
+			ComponentFirstName name;
+			name.name.fill(letter);
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, name);
+			(builder.AddComponent(id, components), ...);
+			return id;
+		};
+		auto nameAt = [](const SystemsManagerST::ArchetypeGroup &group, ui32 index)
+		{
+			return reinterpret_cast<const ComponentFirstName *>(group.components[0].data.get())[index].name[0];
+		};
+		auto isListed = [&manager](const SystemsManagerST::ArchetypeGroup &group, const ArchetypeReflector::StoredArchetype *archetype)
+		{
+			auto it = manager->_archetypeGroups.find(archetype);
+			return it != manager->_archetypeGroups.end() && std::any_of(it->second.begin(), it->second.end(), [&group](const SystemsManagerST::ArchetypeGroup &stored) { return &stored == &group; });
+		};
+
+		vector<EntityID> withLastName, tagged, withDate;
+		for (char letter = 'a'; letter < 'd'; ++letter)
+		{
+			withLastName.push_back(addEntity(letter, ComponentLastName{}));
+		}
+		EntityID untagged = addEntity('d');
+		tagged.push_back(addEntity('e', TagTest0{}));
+		tagged.push_back(addEntity('f', TagTest0{}));
+		withDate.push_back(addEntity('g', ComponentDateOfBirth{}));
+		withDate.push_back(addEntity('h', ComponentDateOfBirth{}));
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		builder.Clear();
+
+		auto locationOf = [&manager](EntityID id) { return manager->_entitiesLocations[id.Hint()]; };
+		auto &lastNameGroup = *locationOf(withLastName[0]).group;
+		auto &untaggedGroup = *locationOf(untagged).group;
+		auto &taggedGroup = *locationOf(tagged[0]).group;
+		auto &dateGroup = *locationOf(withDate[0]).group;
+		ASSUME(lastNameGroup.entitiesCount == 3 && untaggedGroup.entitiesCount == 1 && taggedGroup.entitiesCount == 2 && dateGroup.entitiesCount == 2);
+
+		// destroying the whole group sends its entities as a single stream
+		Archetype lastNameArchetype = lastNameGroup.archetype.ToShort();
+		ArchetypeDefiningRequirement lastNameQuery[] = {{ComponentLastName::GetTypeId(), 0, RequirementForComponent::Required}};
+		builder.DestroyMatching(ToArray(lastNameQuery));
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		ASSUME(lastNameGroup.entitiesCount == 0);
+		for (EntityID id : withLastName)
+		{
+			ASSUME(locationOf(id).group == nullptr && locationOf(id).index == ui32_max);
+		}
+		ASSUME(builder._entityRemovedStreams._data.size() == 1);
+		const auto &[removedArchetype, removed] = builder._entityRemovedStreams._data.front();
+		ASSUME(removedArchetype == lastNameArchetype && *removed == withLastName);
+		builder.Clear();
+
+		// there's no group with the new archetype, so the group is re-keyed in place
+		ArchetypeFull dateArchetypeFull = dateGroup.archetype;
+		Archetype dateArchetype = dateArchetypeFull.ToShort();
+		const auto *dateReflected = dateGroup.reflected;
+		ArchetypeDefiningRequirement dateQuery[] = {{ComponentDateOfBirth::GetTypeId(), 0, RequirementForComponent::Required}};
+		builder.AddTagMatching<TagTest1>(ToArray(dateQuery));
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		ASSUME(dateGroup.entitiesCount == 2 && dateGroup.tagsCount == 1 && dateGroup.tags[0] == TagTest1::GetTypeId());
+		ASSUME(dateGroup.archetype.ToShort() != dateArchetype);
+		ASSUME(dateGroup.reflected != dateReflected && dateGroup.reflected->archetype == dateGroup.archetype.ToShort());
+		ASSUME(isListed(dateGroup, dateGroup.reflected) && isListed(dateGroup, dateReflected) == false);
+		ComponentArrayBuilder dateComponents;
+		dateComponents.AddComponent(ComponentFirstName{}).AddComponent(ComponentDateOfBirth{});
+		ASSUME(manager->_archetypeGroupsFull.Find(dateArchetypeFull, dateComponents.GetComponents()) == nullptr);
+		dateComponents.AddComponent(TagTest1{});
+		ASSUME(manager->_archetypeGroupsFull.Find(dateGroup.archetype, dateComponents.GetComponents()) == &dateGroup);
+		for (uiw index = 0; index < withDate.size(); ++index)
+		{
+			ASSUME(locationOf(withDate[index]).group == &dateGroup && locationOf(withDate[index]).index == index && nameAt(dateGroup, static_cast<ui32>(index)) == 'g' + index);
+		}
+		ASSUME(builder._componentAddedStreams._data.empty()); // nobody receives ComponentAdded for TagTest1
+		builder.Clear();
+
+		// the group without the tag already exists, so the rows are appended to it
+		ArchetypeDefiningRequirement taggedQuery[] = {{TagTest0::GetTypeId(), 0, RequirementForComponent::Required}};
+		builder.RemoveTagMatching<TagTest0>(ToArray(taggedQuery));
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		ASSUME(taggedGroup.entitiesCount == 0 && untaggedGroup.entitiesCount == 3);
+		ASSUME(nameAt(untaggedGroup, 0) == 'd' && nameAt(untaggedGroup, 1) == 'e' && nameAt(untaggedGroup, 2) == 'f');
+		for (uiw index = 0; index < tagged.size(); ++index)
+		{
+			ASSUME(locationOf(tagged[index]).group == &untaggedGroup && locationOf(tagged[index]).index == index + 1);
+			ASSUME(untaggedGroup.entities[index + 1] == tagged[index]);
+		}
+		ASSUME(builder._componentRemovedStreams._data.size() == 1);
+		const auto &[removedType, removedTags] = builder._componentRemovedStreams._data.front();
+		ASSUME(removedType == TagTest0::GetTypeId() && removedTags->entityIds == tagged && removedTags->componentIds.empty());
+		builder.Clear();
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished matching commands tests\n");
+		}
+	}
+
+	static void ChangedFilterTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		auto writerPipeline = manager->CreatePipeline(nullopt, false);
+		auto readerPipeline = manager->CreatePipeline(nullopt, false);
+		manager->Register(make_unique<ChangedWriterSystem>(), writerPipeline);
+		auto reader = make_unique<ChangedReaderSystem>();
+		auto &passed = reader->passed;
+		manager->Register(move(reader), readerPipeline);
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+		vector<EntityID> written, notWritten;
+		for (ui32 index = 0; index < 4; ++index)
+		{
+			ComponentDateOfBirth date;
+			date.dateOfBirth = index;
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, date);
+			if (index % 2)
+			{
+				builder.AddComponent(id, TagTest0{});
+				written.push_back(id);
+			}
+			else
+			{
+				notWritten.push_back(id);
+			}
+		}
+		++manager->_writeVersion; // the added entities are newer than anything the systems have seen, as with the initial streaming
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		builder.Clear();
+
+		auto executeReader = [&manager, &passed]
+		{
+			passed.clear();
+			manager->ExecutePipeline(manager->_pipelines[1], {});
+			return passed;
+		};
+
+		// the added entities are changes, then nothing gets written
+		ASSUME(executeReader().size() == 4);
+		ASSUME(executeReader().empty());
+
+		// the filter works with whole groups, the group without writes is skipped
+		manager->ExecutePipeline(manager->_pipelines[0], {});
+		ASSUME(executeReader() == written);
+		ASSUME(executeReader().empty());
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished changed filter tests\n");
+		}
+	}
+
+	static void SortKeyTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		manager->SetSortKey<ComponentDateOfBirth>([](const ComponentDateOfBirth &date) { return static_cast<ui64>(date.dateOfBirth); });
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+
+		// the same ComponentIDs for every entity put them into a single group with a stride 2 non-unique column
+		const ui32 dates[] = {5, 3, 5, 1, 3, 0, 5, 2};
+		vector<EntityID> ids;
+		for (ui32 index = 0; index < CountOf(dates); ++index)
+		{
+			ComponentDateOfBirth date;
+			date.dateOfBirth = dates[index];
+			ComponentArtist first, second;
+			first.area = static_cast<ComponentArtist::Areas>(index);
+			second.area = static_cast<ComponentArtist::Areas>(index + 100);
+
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, date);
+			builder.AddComponent(id, first, ComponentID(1));
+			builder.AddComponent(id, second, ComponentID(2));
+			ids.push_back(id);
+		}
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		builder.Clear();
+
+		auto &group = *manager->_entitiesLocations[ids[0].Hint()].group;
+		ASSUME(group.entitiesCount == CountOf(dates));
+		auto column = [&group](TypeId type) -> const SystemsManagerST::ArchetypeGroup::ComponentArray &
+		{
+			auto *found = std::find_if(group.components.get(), group.components.get() + group.uniqueTypedComponentsCount, [type](const SystemsManagerST::ArchetypeGroup::ComponentArray &stored) { return stored.type == type; });
+			ASSUME(found != group.components.get() + group.uniqueTypedComponentsCount);
+			return *found;
+		};
+		const auto &artists = column(ComponentArtist::GetTypeId());
+		ASSUME(artists.stride == 2);
+
+		manager->SortArchetypeGroups();
+
+		const auto *sortedDates = reinterpret_cast<const ComponentDateOfBirth *>(column(ComponentDateOfBirth::GetTypeId()).data.get());
+		const auto *sortedArtists = reinterpret_cast<const ComponentArtist *>(artists.data.get());
+		ui32 previousIndex = 0;
+		for (ui32 row = 0; row < group.entitiesCount; ++row)
+		{
+			// the first artist stores the entity's original index
+			ui32 index = static_cast<ui32>(sortedArtists[row * 2].area);
+			ASSUME(sortedDates[row].dateOfBirth == dates[index]);
+			ASSUME(static_cast<ui32>(sortedArtists[row * 2 + 1].area) == index + 100);
+			ASSUME(artists.ids[row * 2] == ComponentID(1) && artists.ids[row * 2 + 1] == ComponentID(2));
+			ASSUME(group.entities[row] == ids[index]);
+			ASSUME(manager->_entitiesLocations[ids[index].Hint()].group == &group && manager->_entitiesLocations[ids[index].Hint()].index == row);
+			if (row)
+			{
+				ASSUME(sortedDates[row - 1].dateOfBirth <= sortedDates[row].dateOfBirth);
+				if (sortedDates[row - 1].dateOfBirth == sortedDates[row].dateOfBirth)
+				{
+					ASSUME(previousIndex < index); // the equal keys keep their relative order
+				}
+			}
+			previousIndex = index;
+		}
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished sort key tests\n");
+		}
+	}
+
+	static void PartitionedComponentChangedTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		manager->SetComponentChangedPartitioning(true);
+		auto writerPipeline = manager->CreatePipeline(nullopt, false);
+		auto recorderPipeline = manager->CreatePipeline(nullopt, false);
+		manager->Register(make_unique<ChangedWriterSystem>(), writerPipeline);
+		manager->Register(make_unique<ChangedRecorderSystem>(), recorderPipeline);
+		auto &queue = manager->_pipelines[1].indirectSystems.front().messageQueue;
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+		vector<EntityID> ids;
+		for (ui32 index = 0; index < 8; ++index)
+		{
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, ComponentDateOfBirth{});
+			if (index % 2)
+			{
+				builder.AddComponent(id, TagTest0{});
+			}
+			ids.push_back(id);
+		}
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		manager->PassMessagesToIndirectSystemsAndClear(builder, nullptr);
+		queue.clear();
+
+		// the changes come in the reverse order and interleave the groups
+		for (uiw index = ids.size(); index--; )
+		{
+			ComponentDateOfBirth date;
+			date.dateOfBirth = static_cast<ui32>(index);
+			builder.ComponentChanged(ids[index], date);
+		}
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		manager->PassMessagesToIndirectSystemsAndClear(builder, nullptr);
+
+		ASSUME(queue.componentChangedStreams.size() == 2);
+		ASSUME(queue.componentChangedStreams[0].Archetype() != queue.componentChangedStreams[1].Archetype());
+		for (const auto &stream : queue.componentChangedStreams)
+		{
+			const auto *group = manager->_entitiesLocations[stream._source->EntityIds()[0].Hint()].group;
+			ASSUME(stream.Archetype() == group->archetype.ToShort());
+			ASSUME(stream._source->EntityIds().size() == ids.size() / 2);
+
+			optional<ui32> previousRow;
+			for (auto [date, id] : stream.Enumerate<ComponentDateOfBirth>())
+			{
+				const auto &location = manager->_entitiesLocations[id.Hint()];
+				ASSUME(location.group == group);
+				ASSUME(!previousRow || *previousRow < location.index);
+				ASSUME(ids[date.dateOfBirth] == id);
+				previousRow = location.index;
+			}
+		}
+		queue.clear();
+
+		// a direct system's write is passed as a view of the group's column, it still gets the group's archetype
+		manager->ExecutePipeline(manager->_pipelines[0], {});
+		ASSUME(queue.componentChangedStreams.size() == 1);
+		const auto &written = queue.componentChangedStreams[0];
+		ASSUME(written.Archetype() == manager->_entitiesLocations[ids[1].Hint()].group->archetype.ToShort());
+		ASSUME(written._source->EntityIds().size() == ids.size() / 2);
+		queue.clear();
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished partitioned component changed tests\n");
+		}
+	}
+
+	static void ArchetypeCollisionTests(bool isSuppressLogs)
+	{
+		// an archetype whose hash collides with another one's is stored apart and matched by its own types
+		array<TypeId, 2> artistTypes = {ComponentArtist::GetTypeId(), ComponentDateOfBirth::GetTypeId()};
+		array<TypeId, 2> designerTypes = {ComponentDesigner::GetTypeId(), ComponentSpouse::GetTypeId()};
+		Archetype artist = GenerateArchetype(Funcs::SortCompileTime(artistTypes));
+		Archetype designer = GenerateArchetype(Funcs::SortCompileTime(designerTypes));
+		designer._typePart = artist._typePart;
+
+		ArchetypeReflector reflector;
+		array<System::ComponentRequest, 1> designerRequest = {System::ComponentRequest{ComponentDesigner::GetTypeId(), false, RequirementForComponent::Required}};
+		reflector.StartTrackingMatchingArchetypes(0, ToArray(ToRequired(designerRequest)));
+		const auto &storedArtist = reflector.AddToLibrary(artist, ToTypes(Funcs::SortCompileTime(artistTypes)));
+		const auto &storedDesigner = reflector.AddToLibrary(designer, ToTypes(Funcs::SortCompileTime(designerTypes)));
+		ASSUME(&storedArtist != &storedDesigner);
+		ASSUME(reflector.Find(artist, ToArray(storedArtist.types)) == &storedArtist);
+		ASSUME(reflector.Find(designer, ToArray(storedDesigner.types)) == &storedDesigner);
+		ASSUME(&reflector.AddToLibrary(designer, ToTypes(Funcs::SortCompileTime(designerTypes))) == &storedDesigner);
+		ASSUME(reflector.FindMatchingArchetypes(0).size() == 1 && reflector.FindMatchingArchetypes(0)[0] == &storedDesigner);
+
+		// the groups table, a probe sequence wraps around the end of the slots and loses a slot in the middle
+		SystemsManagerST::ArchetypeGroupsTable table;
+		const TypeId types[] = {ComponentArtist::GetTypeId(), ComponentFirstName::GetTypeId(), ComponentLastName::GetTypeId(), ComponentDateOfBirth::GetTypeId(), ComponentCompany::GetTypeId()};
+		SerializedComponent components[CountOf(types)];
+		ArchetypeFull archetypes[CountOf(types)];
+		constexpr ui64 hashes[] = {14, 14, 14, 1, 14}; // the slots are 14, 15, 0, 1 and 2
+		vector<SystemsManagerST::ArchetypeGroup *> groups;
+		for (uiw index = 0; index < CountOf(types); ++index)
+		{
+			components[index].type = types[index];
+			archetypes[index]._idPart = hashes[index];
+			groups.push_back(&table.Insert(archetypes[index], {&components[index], 1}));
+		}
+		ASSUME(table._slots.size() == 16);
+		auto slotOf = [&table](const SystemsManagerST::ArchetypeGroup *group) -> uiw
+		{
+			for (uiw index = 0; index < table._slots.size(); ++index)
+			{
+				if (table._slots[index].group == group)
+				{
+					return index;
+				}
+			}
+			return uiw_max;
+		};
+		ASSUME(slotOf(groups[0]) == 14 && slotOf(groups[1]) == 15 && slotOf(groups[2]) == 0 && slotOf(groups[3]) == 1 && slotOf(groups[4]) == 2);
+
+		// the second group moves away, the rest of the sequence shifts back except the group that's already at its desired slot
+		ArchetypeFull moved;
+		moved._idPart = 7;
+		table.Rekey(*groups[1], moved, {&components[1], 1});
+		ASSUME(slotOf(groups[1]) == 7);
+		ASSUME(slotOf(groups[0]) == 14 && slotOf(groups[2]) == 15 && slotOf(groups[3]) == 1 && slotOf(groups[4]) == 0);
+		ASSUME(table._slots[2].group == nullptr);
+		ASSUME(table.Find(moved, {&components[1], 1}) == groups[1]);
+		ASSUME(table.Find(archetypes[1], {&components[1], 1}) == nullptr);
+		for (uiw index : {0, 2, 3, 4})
+		{
+			ASSUME(table.Find(archetypes[index], {&components[index], 1}) == groups[index]);
+		}
+
+		// the head of the sequence goes
+		table.EraseSlot(14);
+		ASSUME(slotOf(groups[2]) == 14 && slotOf(groups[4]) == 15 && slotOf(groups[3]) == 1 && table._slots[0].group == nullptr);
+		ASSUME(table.Find(archetypes[0], {&components[0], 1}) == nullptr);
+		for (uiw index : {2, 3, 4})
+		{
+			ASSUME(table.Find(archetypes[index], {&components[index], 1}) == groups[index]);
+		}
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished archetype collision tests\n");
+		}
+	}
+
+	static void LatestStateTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		auto pipeline = manager->CreatePipeline(nullopt, false);
+		auto system = make_unique<LatestStateSystem>();
+		auto &seen = system->seen;
+		manager->Register(move(system), pipeline);
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+		vector<EntityID> ids;
+		for (ui32 index = 0; index < 3; ++index)
+		{
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, ComponentDateOfBirth{});
+			ids.push_back(id);
+		}
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		manager->PassMessagesToIndirectSystemsAndClear(builder, nullptr);
+
+		auto change = [&builder](EntityID id, ui32 value)
+		{
+			ComponentDateOfBirth date;
+			date.dateOfBirth = value;
+			builder.ComponentChanged(id, date);
+		};
+		auto deliver = [&manager, &builder]
+		{
+			manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+			manager->PassMessagesToIndirectSystemsAndClear(builder, nullptr);
+		};
+
+		// the first entity changes within a stream and between the streams, the last one doesn't change at all
+		change(ids[0], 1);
+		change(ids[1], 10);
+		change(ids[0], 2);
+		deliver();
+		change(ids[0], 3);
+		deliver();
+
+		manager->ExecutePipeline(manager->_pipelines[0], {});
+		ASSUME(seen.size() == 2);
+		ASSUME(std::find(seen.begin(), seen.end(), pair<EntityID, ui32>(ids[0], 3)) != seen.end());
+		ASSUME(std::find(seen.begin(), seen.end(), pair<EntityID, ui32>(ids[1], 10)) != seen.end());
+
+		// the delivered values aren't kept for the next execution
+		seen.clear();
+		change(ids[1], 11);
+		deliver();
+		manager->ExecutePipeline(manager->_pipelines[0], {});
+		ASSUME(seen.size() == 1 && seen[0].first == ids[1] && seen[0].second == 11);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished latest state tests\n");
+		}
+	}
+
+	static void UnroutedWriteTests(bool isSuppressLogs)
+	{
+		// the only system requesting the dates doesn't accept ComponentChanged, so the direct writes aren't sent
+		auto manager = SystemsManagerST::New(Log);
+		auto writerPipeline = manager->CreatePipeline(nullopt, false);
+		auto addedPipeline = manager->CreatePipeline(nullopt, false);
+		manager->Register(make_unique<ChangedWriterSystem>(), writerPipeline);
+		manager->Register(make_unique<AddedOnlySystem>(), addedPipeline);
+		auto &queue = manager->_pipelines[1].indirectSystems.front().messageQueue;
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+		EntityID id = builder.AddEntity();
+		builder.AddComponent(id, ComponentDateOfBirth{});
+		builder.AddComponent(id, TagTest0{});
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		manager->PassMessagesToIndirectSystemsAndClear(builder, nullptr);
+		queue.clear();
+
+		manager->ExecutePipeline(manager->_pipelines[0], {});
+		ASSUME(queue.componentChangedStreams.empty());
+		ASSUME(manager->_componentChangedViews.empty());
+
+		// the write is still recorded for the Changed filters
+		const auto &location = manager->_entitiesLocations[id.Hint()];
+		const auto &group = *location.group;
+		auto *dates = std::find_if(group.components.get(), group.components.get() + group.uniqueTypedComponentsCount, [](const SystemsManagerST::ArchetypeGroup::ComponentArray &stored) { return stored.type == ComponentDateOfBirth::GetTypeId(); });
+		ASSUME(dates->writtenAt == manager->_writeVersion);
+		ASSUME(reinterpret_cast<const ComponentDateOfBirth *>(dates->data.get())[location.index].dateOfBirth == 1);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished unrouted write tests\n");
+		}
+	}
+
+	static void ParallelComponentChangedTests(bool isSuppressLogs)
+	{
+		constexpr ui32 count = 100;
+		EntityIDGenerator idGenerator;
+		auto stream = make_unique<EntitiesStream>();
+		vector<EntityID> ids;
+		for (ui32 index = 0; index < count; ++index)
+		{
+			EntitiesStream::EntityData entity;
+			entity.AddComponent(ComponentDateOfBirth{});
+			if (index % 3 == 0)
+			{
+				entity.AddComponent(TagTest0{}); // the changes span two groups
+			}
+			ids.push_back(idGenerator.Generate());
+			stream->AddEntity(ids.back(), move(entity));
+		}
+
+		auto manager = SystemsManagerST::New(Log);
+		manager->SetParallelComponentChangedThreshold(count / 4);
+		ASSUME(manager->_parallelComponentChangedThreshold == count / 4);
+		auto pipeline = manager->CreatePipeline(nullopt, false);
+		auto sender = make_unique<ChangedSenderSystem>();
+		sender->ids = ids;
+		manager->Register(move(sender), pipeline);
+
+		vector<WorkerThread> workers(3);
+		vector<unique_ptr<IEntitiesStream>> streams;
+		streams.push_back(move(stream));
+		manager->Start({}, move(idGenerator), move(workers), move(streams));
+		while (manager->GetPipelineInfo(pipeline).executedTimes < 3)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		manager->Pause(true);
+
+		// the changes exceed the threshold and are split between the workers
+		for (ui32 index = 0; index < count; ++index)
+		{
+			const auto &location = manager->_entitiesLocations[ids[index].Hint()];
+			const auto &group = *location.group;
+			auto *dates = std::find_if(group.components.get(), group.components.get() + group.uniqueTypedComponentsCount, [](const SystemsManagerST::ArchetypeGroup::ComponentArray &stored) { return stored.type == ComponentDateOfBirth::GetTypeId(); });
+			ASSUME(reinterpret_cast<const ComponentDateOfBirth *>(dates->data.get())[location.index].dateOfBirth == 1000 + index);
+		}
+
+		manager->Stop(true);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished parallel component changed tests\n");
+		}
+	}
+
+	static void NestedDirectQueryTests(bool isSuppressLogs)
+	{
+		// 3 entities have only the date, 2 have the name as well, so the outer query visits two groups
+		EntityIDGenerator idGenerator;
+		auto stream = make_unique<EntitiesStream>();
+		for (ui32 index = 0; index < 5; ++index)
+		{
+			EntitiesStream::EntityData entity;
+			entity.AddComponent(ComponentDateOfBirth{});
+			if (index >= 3)
+			{
+				entity.AddComponent(ComponentFirstName{});
+			}
+			stream->AddEntity(idGenerator.Generate(), move(entity));
+		}
+
+		auto manager = SystemsManagerST::New(Log);
+		auto pipeline = manager->CreatePipeline(nullopt, false);
+		auto systemOwned = make_unique<NestedQuerySystem>();
+		auto &system = *systemOwned;
+		manager->Register(move(systemOwned), pipeline);
+
+		vector<unique_ptr<IEntitiesStream>> streams;
+		streams.push_back(move(stream));
+		manager->Start({}, move(idGenerator), {}, move(streams));
+		while (manager->GetPipelineInfo(pipeline).executedTimes < 3)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		manager->Pause(true);
+
+		ASSUME(system.outerSeen == 5);
+		ASSUME(system.innerSeen == 4); // the named group is visited once per outer group
+		ASSUME(manager->_directQueryArguments.size() == 2 && manager->_directQueryDepth == 0); // each depth reuses its arguments between the frames
+
+		manager->Stop(true);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished nested direct query tests\n");
+		}
+	}
+
+	static void ReactiveSystemTests(bool isSuppressLogs)
+	{
+		auto manager = SystemsManagerST::New(Log);
+		auto driverPipeline = manager->CreatePipeline(nullopt, false);
+		auto reactivePipeline = manager->CreatePipeline(nullopt, false);
+		auto driverSystem = make_unique<ReactiveDriverSystem>();
+		auto &driver = *driverSystem;
+		driverSystem->SetKeyController(KeyController::New());
+		manager->Register(move(driverSystem), driverPipeline);
+		auto reactiveSystem = make_unique<ReactiveDateSystem>();
+		reactiveSystem->SetKeyController(KeyController::New());
+		manager->Register(move(reactiveSystem), reactivePipeline);
+
+		MessageBuilder builder;
+		builder.SetEntityIdGenerator(&manager->_entityIdGenerator);
+		vector<EntityID> ids;
+		for (ui32 index = 0; index < 2; ++index)
+		{
+			EntityID id = builder.AddEntity();
+			builder.AddComponent(id, ComponentDateOfBirth{});
+			builder.AddComponent(id, ComponentFirstName{});
+			ids.push_back(id);
+		}
+		++manager->_writeVersion; // the added entities are newer than anything the systems have seen, as with the initial streaming
+		manager->UpdateECSFromMessagesAndCreateArchetypedMessageBuilders(builder);
+		builder.Clear();
+
+		const auto &reactive = manager->_pipelines[1].directSystems.front();
+		auto frame = [&manager]
+		{
+			manager->ExecutePipeline(manager->_pipelines[0], {});
+			manager->ExecutePipeline(manager->_pipelines[1], {});
+			manager->TrimControlsLog();
+		};
+		auto isExecuted = [&manager, &reactive, &frame, reactivePipeline]
+		{
+			ui32 executedBefore = reactive.executedTimes;
+			ui32 skippedBefore = manager->GetPipelineInfo(reactivePipeline).skippedExecutions;
+			frame();
+			ui32 skipped = manager->GetPipelineInfo(reactivePipeline).skippedExecutions - skippedBefore;
+			ui32 executed = reactive.executedTimes - executedBefore;
+			ASSUME(skipped + executed == 1);
+			return executed == 1;
+		};
+
+		ASSUME(isExecuted()); // the first execution is never skipped
+
+		// nothing changed
+		ASSUME(isExecuted() == false);
+		ASSUME(isExecuted() == false);
+		ASSUME(manager->GetPipelineInfo(reactivePipeline).skippedExecutions == 2);
+
+		// a change of a component that isn't an input
+		driver.namesToChange.push_back(ids[0]);
+		ASSUME(isExecuted() == false);
+
+		driver.datesToChange.push_back(ids[0]);
+		ASSUME(isExecuted());
+		ASSUME(isExecuted() == false);
+
+		driver.entitiesToRemove.push_back(ids[1]);
+		ASSUME(isExecuted());
+		ASSUME(isExecuted() == false);
+
+		driver.isSendingControl = true;
+		ASSUME(isExecuted());
+		ASSUME(isExecuted() == false);
+
+		if (!isSuppressLogs)
+		{
+			Log->Info("", "finished reactive system tests\n");
+		}
+	}
 };
 
 void PerformUnitTests(bool isSuppressLogs)
@@ -654,5 +2229,25 @@ void PerformUnitTests(bool isSuppressLogs)
     ArchetypeTests(isSuppressLogs);
     ReflectorTests(isSuppressLogs);
     UnitTests::MessageBuilderTests(isSuppressLogs);
+    UnitTests::MessageBuilderPoolingTests(isSuppressLogs);
+    UnitTests::MessageBuilderCoalescingTests(isSuppressLogs);
+    UnitTests::MessageBuilderRangeTests(isSuppressLogs);
+    UnitTests::MessageBuilderSpawnBatchTests(isSuppressLogs);
+    UnitTests::MessageBuilderPrefabTests(isSuppressLogs);
 	ArgumentPropertiesTests();
+	SpatialHashGridTests(isSuppressLogs);
+	TransformHierarchyTests(isSuppressLogs);
+	ParallelForEachTests(isSuppressLogs);
+	ControlsRingTests(isSuppressLogs);
+	UnitTests::ControlsLogTests(isSuppressLogs);
+	UnitTests::MatchingCommandsTests(isSuppressLogs);
+	UnitTests::ChangedFilterTests(isSuppressLogs);
+	UnitTests::SortKeyTests(isSuppressLogs);
+	UnitTests::ReactiveSystemTests(isSuppressLogs);
+	UnitTests::ArchetypeCollisionTests(isSuppressLogs);
+	UnitTests::LatestStateTests(isSuppressLogs);
+	UnitTests::ParallelComponentChangedTests(isSuppressLogs);
+	UnitTests::PartitionedComponentChangedTests(isSuppressLogs);
+	UnitTests::UnroutedWriteTests(isSuppressLogs);
+	UnitTests::NestedDirectQueryTests(isSuppressLogs);
 }
\ No newline at end of file